@@ -26,7 +26,9 @@
 #define SM_CHUNK (DATA_SIZE / NUM_SM)
 #define CHUNK_INT 256
 
+#ifndef MSG_KEY
 #define MSG_KEY 0x1234
+#endif
 
 /* ===================== MSG ===================== */
 struct msgbuf {
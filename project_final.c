@@ -8,6 +8,61 @@
 #include <sys/wait.h>
 #include <sys/time.h>
 #include <sys/sem.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(TRANSPORT_UNIX) || defined(TRANSPORT_TCP) || defined(TRANSPORT_MEMFD)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#endif
+#ifdef TRANSPORT_SPLICE
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <poll.h>
+#ifndef F_SETPIPE_SZ                /* _GNU_SOURCE 전용 상수 */
+#define F_SETPIPE_SZ (1024 + 7)
+#endif
+#ifndef SPLICE_F_MOVE
+#define SPLICE_F_MOVE 1
+#endif
+#endif
+#ifdef EXCHANGE_VM
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/prctl.h>
+#ifndef PR_SET_PTRACER              /* Yama: 형제 process 가 내 메모리를 읽도록 허용 */
+#define PR_SET_PTRACER 0x59616d61
+#endif
+#ifndef PR_SET_PTRACER_ANY
+#define PR_SET_PTRACER_ANY ((unsigned long)-1)
+#endif
+#endif
+#ifdef TRANSPORT_MEMFD
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/memfd.h>
+/* glibc 는 seal 상수를 _GNU_SOURCE 에서만 주는데, 그러면 struct msgbuf 가 겹친다 */
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS   (1024 + 9)
+#define F_GET_SEALS   (1024 + 10)
+#define F_SEAL_SEAL   0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW   0x0004
+#define F_SEAL_WRITE  0x0008
+#endif
+#endif
 
 /* ===================== MODE ===================== */
 #define LOGICAL_SM 8
@@ -16,28 +71,457 @@
 #define NUM_SM 8
 #elif defined(GRID_4x4)
 #define NUM_SM 4
-#define LOGICAL_CHUNK (DATA_SIZE / LOGICAL_SM)   /* 512 */
 #else
 #error "Define GRID_8x8 or GRID_4x4"
 #endif
 
+/* -DN=... 로 행렬 크기 변경 (8의 배수, 기본 64) */
+#ifndef N
 #define N 64
-#define DATA_SIZE (N*N)
+#endif
+/*
+ * -DELEM_SIZE=... 로 원소 byte 크기 변경 (4 의 배수, 기본 4 = int).
+ * N x N 원소 행렬을 N x ROW_WORDS 의 4-byte word 행렬로 보고, buffer / message /
+ * RAID stripe 크기는 모두 word 단위. 원소 g 의 word k 에는 g * ELEM_WORDS + k 를 쓴다.
+ */
+#ifndef ELEM_SIZE
+#define ELEM_SIZE 4
+#endif
+#define ELEM_WORDS (ELEM_SIZE / 4)
+#define ROW_WORDS (N * ELEM_WORDS)
+#define DATA_SIZE (N * ROW_WORDS)
 #define SM_CHUNK (DATA_SIZE / NUM_SM)
+#define LOGICAL_CHUNK (DATA_SIZE / LOGICAL_SM)   /* N=64, 4 byte: 512 */
+#define TILE (N / 4)                             /* GRID_4x4 tile 크기 */
+#define STRIP (N / 8)                            /* GRID_8x8 column strip 폭 */
 #define CHUNK_INT 256
+#define MSGS_PER_SM (LOGICAL_CHUNK / CHUNK_INT)
+
+#if N % 8 != 0 || LOGICAL_CHUNK % CHUNK_INT != 0
+#error "N must be a multiple of 8 and N*N/8 a multiple of CHUNK_INT"
+#endif
+#if ELEM_SIZE % 4 != 0 || ELEM_SIZE <= 0
+#error "ELEM_SIZE must be a positive multiple of 4"
+#endif
+#if ELEM_SIZE != 4 && (defined(REDIST_INPLACE) || defined(OUT_OF_CORE) || \
+    defined(WORK_STEALING) || defined(PUSH_MODE))
+#error "ELEM_SIZE != 4 is supported by the gather kernels, REDIST_PLAN and EXCHANGE_VM"
+#endif
+
+/* -DOUT_OF_CORE: BAND_ROWS 줄 단위 window 로 처리 (band 는 한 domain 안에 있어야 함) */
+#ifdef OUT_OF_CORE
+#ifndef BAND_ROWS
+#define BAND_ROWS (N / 8 < 64 ? N / 8 : 64)
+#endif
+#define BAND_SIZE (BAND_ROWS * N)
+#define NUM_BANDS (N / BAND_ROWS)
+#if (N / 8) % BAND_ROWS != 0 || BAND_SIZE % CHUNK_INT != 0
+#error "BAND_ROWS must divide N/8 and BAND_ROWS*N must be a multiple of CHUNK_INT"
+#endif
+#ifdef REDIST_INPLACE
+#error "OUT_OF_CORE and REDIST_INPLACE are exclusive"
+#endif
+#endif
+
+/* -DWORK_STEALING: 목적지 row tile 을 SM 별 deque 에 두고 놀고 있는 SM 이 훔쳐 감 */
+#ifdef WORK_STEALING
+#ifndef STEAL_ROWS
+#define STEAL_ROWS 1
+#endif
+#define TILES_PER_SM ((N / 8) / STEAL_ROWS)
+#if (N / 8) % STEAL_ROWS != 0
+#error "STEAL_ROWS must divide N/8"
+#endif
+#if defined(REDIST_INPLACE) || defined(OUT_OF_CORE)
+#error "WORK_STEALING cannot be combined with REDIST_INPLACE or OUT_OF_CORE"
+#endif
+#endif
+
+/* -DPUSH_MODE: source SM 이 자기 dist 를 목적지 domain inbox 에 직접 scatter */
+#ifdef PUSH_MODE
+#ifndef NT_MIN_INTS
+#define NT_MIN_INTS 16      /* 이 길이 이상의 run 은 non-temporal store */
+#endif
+#if defined(REDIST_INPLACE) || defined(OUT_OF_CORE) || defined(WORK_STEALING)
+#error "PUSH_MODE cannot be combined with REDIST_INPLACE, OUT_OF_CORE or WORK_STEALING"
+#endif
+#endif
+
+/* 목적지 domain 을 공유 ord segment 에 두는 모드 */
+#if defined(WORK_STEALING) || defined(PUSH_MODE)
+#define ORD_SEGMENT
+#endif
+
+/* ord 가 shared memory 에 있어 다른 SM 도 쓰는 모드: ord 파일은 barrier 뒤에 저장 */
+#if defined(REDIST_INPLACE) || defined(ORD_SEGMENT)
+#define ORD_SHARED
+#endif
+
+/* -DDAEMON_MODE: IPC 자원과 SM worker 를 한 번만 만들고 NUM_JOBS 개 job 처리 */
+#ifdef DAEMON_MODE
+#ifndef NUM_JOBS
+#define NUM_JOBS 10
+#endif
+#if defined(OUT_OF_CORE) || defined(ORD_SHARED)
+#error "DAEMON_MODE cannot be combined with OUT_OF_CORE, REDIST_INPLACE, WORK_STEALING or PUSH_MODE"
+#endif
+#endif
+
+/*
+ * -DINCREMENTAL (DAEMON_MODE 와 함께): job 을 frame 으로 보고, 직전 frame 이후
+ * 바뀐 DIRTY_TILE x DIRTY_TILE tile 만 재정렬 / 전송 / RAID 의 stripe 위치에 덮어쓴다.
+ * frame 0 은 전체, 이후 frame 은 tile 의 DIRTY_PCT % 를 새 값으로 쓴다.
+ */
+#ifdef INCREMENTAL
+#ifndef DIRTY_TILE
+#define DIRTY_TILE 16
+#endif
+#ifndef DIRTY_PCT
+#define DIRTY_PCT 5
+#endif
+#define DIRTY_COLS (N / DIRTY_TILE)
+#define DIRTY_TILES (DIRTY_COLS * DIRTY_COLS)
+/* dirty tile 한 줄 (DIRTY_TILE word) = segment. message 하나에 offset 표 + segment 여러 개 */
+#define SEGS_PER_MSG (CHUNK_INT / (DIRTY_TILE + 1))
+#if !defined(DAEMON_MODE)
+#error "INCREMENTAL needs DAEMON_MODE (frames are daemon jobs)"
+#endif
+#if defined(TRANSPORT_MEMFD) || defined(TRANSPORT_SPLICE) || defined(RAID_COMPRESS) || \
+    defined(REDIST_PLAN) || ELEM_SIZE != 4
+#error "INCREMENTAL rewrites fixed-size int chunks of the grid layout in place"
+#endif
+#if N % (8 * DIRTY_TILE) != 0 || CHUNK_INT % DIRTY_TILE != 0
+#error "DIRTY_TILE must divide N/8 and CHUNK_INT"
+#endif
+#if N * N * (NUM_JOBS + 1) > 2147483647
+#error "frame payloads (index + frame * DATA_SIZE) overflow int"
+#endif
+#endif
+
+/* -DEXCHANGE_VM: dist 는 SM private buffer, 목적지 SM 이 process_vm_readv 로 pull */
+#ifdef EXCHANGE_VM
+#if defined(OUT_OF_CORE) || defined(DAEMON_MODE) || defined(ORD_SHARED) || \
+    defined(NUM_TENANTS)
+#error "EXCHANGE_VM replaces the plain reorder kernel (no shared dist segment)"
+#endif
+#endif
+
+/*
+ * -DREDIST_PLAN: 고정 reorder kernel 대신 redistribute() 계획으로 재정렬.
+ * -DREDIST_SRC=... / -DREDIST_DST=... 에 LAYOUT_* 를 주면 임의의 layout 쌍
+ * (기본: grid 배치 -> row block). 계획은 한 번 만들어 job 마다 재사용.
+ */
+#ifdef REDIST_PLAN
+#if defined(REDIST_INPLACE) || defined(OUT_OF_CORE) || defined(ORD_SEGMENT) || \
+    defined(EXCHANGE_VM) || defined(REORDER_GENERIC)
+#error "REDIST_PLAN replaces the gather kernel (plain pull path only)"
+#endif
+#ifndef REDIST_SRC
+#if defined(GRID_8x8)
+#define REDIST_SRC LAYOUT_COLS
+#else
+#define REDIST_SRC LAYOUT_TILES
+#endif
+#endif
+#ifndef REDIST_DST
+#define REDIST_DST LAYOUT_ROWS
+#endif
+#endif
+
+/*
+ * -DCOLL_ALLGATHER / -DCOLL_REDUCE_SCATTER / -DCOLL_ALLREDUCE: 재정렬 대신 collective.
+ * 원소 -DCOLL_INT32 (기본) / -DCOLL_FLOAT / -DCOLL_DOUBLE,
+ * 연산 -DCOLL_SUM (기본) / -DCOLL_MIN / -DCOLL_MAX
+ */
+#if defined(COLL_ALLGATHER) + defined(COLL_REDUCE_SCATTER) + defined(COLL_ALLREDUCE) > 1
+#error "COLL_ALLGATHER, COLL_REDUCE_SCATTER and COLL_ALLREDUCE are exclusive"
+#endif
+#if defined(COLL_ALLGATHER) || defined(COLL_REDUCE_SCATTER) || defined(COLL_ALLREDUCE)
+#define COLLECTIVE
+#if defined(OUT_OF_CORE) || defined(DAEMON_MODE) || defined(ORD_SHARED) || \
+    defined(NUM_TENANTS) || defined(EXCHANGE_VM) || defined(REDIST_PLAN) || \
+    defined(TRANSPORT_MEMFD) || defined(TRANSPORT_SPLICE) || defined(RAID_COMPRESS)
+#error "collectives run their own phase over chunk transports (no reorder mode flags)"
+#endif
+#endif
+
+/*
+ * -DNUM_FIELDS=K: 같은 layout 의 배열 K 개를 한 batch 로 재배치.
+ * dist segment 와 SM domain 은 field 순으로 K 개를 이어 두고, fork / barrier 는
+ * batch 당 한 번, 전송은 K 개 field domain 을 이은 stream 을 그대로 chunk 로 자른다.
+ * field f 의 payload 는 global index + f * DATA_SIZE.
+ */
+#ifndef NUM_FIELDS
+#define NUM_FIELDS 1
+#endif
+#ifndef FIELD_ROWS
+#define FIELD_ROWS 8        /* 고정 kernel 이 field 를 바꿔 가며 처리하는 row 수 */
+#endif
+#define BATCH_MSGS (MSGS_PER_SM * NUM_FIELDS)
+#if NUM_FIELDS < 1
+#error "NUM_FIELDS must be at least 1"
+#endif
+#if NUM_FIELDS > 1 && (defined(REDIST_INPLACE) || defined(OUT_OF_CORE) || \
+    defined(ORD_SEGMENT) || defined(DAEMON_MODE) || defined(NUM_TENANTS) || \
+    defined(EXCHANGE_VM) || defined(COLLECTIVE))
+#error "NUM_FIELDS batches the plain pull path (gather kernels or REDIST_PLAN)"
+#endif
+
+/* dist 를 main 의 shared segment 에 올리는 모드 */
+#if !defined(OUT_OF_CORE) && !defined(EXCHANGE_VM) && !defined(COLLECTIVE)
+#define DIST_SEGMENT
+#endif
+
+/*
+ * -DSTORAGE_LOG: server 는 RAID disk 파일 대신 미리 할당한 log 하나 (raid_log%d.bin) 에
+ * 받은 순서대로 append 한다. LOG_GROUP byte 씩 모아 정렬된 위치에 한 번에 쓰고,
+ * job 끝 (checkpoint) 에 (sm, chunk) -> offset index 를 raid_log%d.idx 로 남긴다.
+ * checkpoint 뒤 server 는 compactor process 를 fork 해 log 를 RAID0 stripe 배치
+ * (raid_disk%d.bin) 로 옮기게 하고 바로 다음 job 수신으로 돌아간다 (job 완료에 포함 안 됨).
+ * DAEMON_MODE 에서는 job 마다 log 의 두 절반을 번갈아 써서 compaction 중인 절반을
+ * 덮어쓰지 않고, 다음 compaction 전에 이전 compactor 를 기다린다.
+ */
+#ifdef STORAGE_LOG
+#ifndef LOG_GROUP
+#define LOG_GROUP (1 << 20)
+#endif
+#define LOG_ALIGN 4096
+#if LOG_GROUP % LOG_ALIGN != 0 || LOG_GROUP % (CHUNK_INT * 4) != 0
+#error "LOG_GROUP must be a multiple of 4096 and of the chunk size"
+#endif
+#if defined(INCREMENTAL) || defined(NUM_TENANTS) || defined(TRANSPORT_MEMFD) || \
+    defined(TRANSPORT_SPLICE) || defined(RAID_COMPRESS)
+#error "STORAGE_LOG logs whole fixed-size chunks received by a plain or daemon server"
+#endif
+#ifdef DAEMON_MODE
+#define LOG_HALVES 2
+#else
+#define LOG_HALVES 1
+#endif
+#endif
+
+/*
+ * -DDISK_EMU: RAID disk 마다 느린 장치를 흉내 낸다 (기록 경로에서 sleep).
+ * token bucket (DISK_MBPS, 최대 DISK_BURST byte 까지 모아 둠) + 기록마다
+ * 지연 (-DDISK_LAT_DIST, 평균 DISK_LAT_US) + DISK_STALL_PPM 확률로 DISK_STALL_US stall.
+ *   0 (기본) DISK_LAT_US + [0, 2 * DISK_JITTER_US) 균등
+ *   1        지수 분포 근사: 난수의 trailing zero 수 (기하 분포) + 균등 소수부
+ *   2        Pareto (alpha = 2): x_m / max(U1, U2), 꼬리가 두꺼움. DISK_LAT_MAX_US 에서 자른다
+ * DISK_SLOW 번 disk 는 대역폭 1/DISK_SLOW_FACTOR, 지연 DISK_SLOW_FACTOR 배.
+ */
+#ifdef DISK_EMU
+#ifndef DISK_MBPS
+#define DISK_MBPS 200
+#endif
+#ifndef DISK_BURST
+#define DISK_BURST (256 * 1024)
+#endif
+#ifndef DISK_LAT_US
+#define DISK_LAT_US 20
+#endif
+#ifndef DISK_JITTER_US
+#define DISK_JITTER_US 10
+#endif
+#ifndef DISK_LAT_DIST
+#define DISK_LAT_DIST 0
+#endif
+#ifndef DISK_LAT_MAX_US
+#define DISK_LAT_MAX_US (100 * DISK_LAT_US)
+#endif
+#if DISK_LAT_DIST < 0 || DISK_LAT_DIST > 2
+#error "DISK_LAT_DIST is 0 (uniform), 1 (exponential) or 2 (pareto)"
+#endif
+#ifndef DISK_STALL_PPM
+#define DISK_STALL_PPM 0
+#endif
+#ifndef DISK_STALL_US
+#define DISK_STALL_US 20000
+#endif
+#ifndef DISK_SLOW
+#define DISK_SLOW (-1)
+#endif
+#ifndef DISK_SLOW_FACTOR
+#define DISK_SLOW_FACTOR 4
+#endif
+#if DISK_SLOW < -1 || DISK_SLOW > 3 || DISK_SLOW_FACTOR < 1
+#error "DISK_SLOW must be a disk 0..3 (or -1) and DISK_SLOW_FACTOR >= 1"
+#endif
+#ifdef STORAGE_LOG
+#error "DISK_EMU throttles the per-disk RAID writers, not the single log"
+#endif
+#endif
 
+/* -DMSG_KEY=... 로 같은 host 의 다른 실행과 key 를 분리 */
+#ifndef MSG_KEY
 #define MSG_KEY 0x1234
+#endif
+
+/* -DNUM_SERVERS=S: server process S 개, server s 는 disk d (d % S == s) 를 담당 */
+#ifndef NUM_SERVERS
+#define NUM_SERVERS 1
+#endif
+#if NUM_SERVERS != 1 && NUM_SERVERS != 2 && NUM_SERVERS != 4
+#error "NUM_SERVERS must divide the 4 RAID disks (1, 2 or 4)"
+#endif
+
+/*
+ * -DNUM_TENANTS=J: 동시에 도는 J 개 job 을 server 하나가 받는다.
+ * job 마다 IPC_PRIVATE queue 와 job_%d/ 출력 디렉토리, server 는 deficit round-robin.
+ * job 0 은 TENANT_BIG 번 반복해 보내는 큰 job.
+ */
+#ifdef NUM_TENANTS
+#ifndef TENANT_BIG
+#define TENANT_BIG 8
+#endif
+#ifndef TENANT_QUANTUM
+#define TENANT_QUANTUM (4 * CHUNK_INT * (int)sizeof(int))   /* round 당 byte */
+#endif
+#define TENANT_PASSES(j) ((j) == 0 ? TENANT_BIG : 1)
+#if defined(DAEMON_MODE) || defined(OUT_OF_CORE) || defined(ORD_SHARED) || \
+    defined(TRANSPORT_UNIX) || defined(TRANSPORT_TCP) || NUM_SERVERS != 1
+#error "NUM_TENANTS runs the plain reorder kernel over the SysV transport with one server"
+#endif
+#endif
+
+/* -DTRANSPORT_UNIX / -DTRANSPORT_TCP: client → server 를 socket 으로 (기본 SysV msg queue) */
+#if defined(TRANSPORT_UNIX) + defined(TRANSPORT_TCP) + defined(TRANSPORT_MEMFD) + \
+    defined(TRANSPORT_SPLICE) > 1
+#error "TRANSPORT_UNIX, TRANSPORT_TCP, TRANSPORT_MEMFD and TRANSPORT_SPLICE are exclusive"
+#endif
+/* -DTRANSPORT_SPLICE: client 는 disk pipe 에 vmsplice, server 는 raid 파일로 splice */
+#ifdef TRANSPORT_SPLICE
+#if defined(OUT_OF_CORE) || defined(DAEMON_MODE) || defined(ORD_SHARED) || \
+    defined(NUM_TENANTS) || defined(RAID_COMPRESS)
+#error "TRANSPORT_SPLICE hands off whole private ord domains (plain kernel path only)"
+#endif
+#ifndef SPLICE_PIPE_SZ
+#define SPLICE_PIPE_SZ (1 << 20)
+#endif
+#endif
+/* -DTRANSPORT_MEMFD: SM domain 을 봉인된 memfd 로 만들어 fd 만 unix socket 으로 넘김 */
+#ifdef TRANSPORT_MEMFD
+#if defined(OUT_OF_CORE) || defined(DAEMON_MODE) || defined(ORD_SHARED) || \
+    defined(NUM_TENANTS) || defined(RAID_COMPRESS)
+#error "TRANSPORT_MEMFD hands off whole private ord domains (plain kernel path only)"
+#endif
+#endif
+#if defined(TRANSPORT_UNIX) || defined(TRANSPORT_MEMFD)
+#define SOCK_UNIX
+#endif
+#if defined(TRANSPORT_UNIX) || defined(TRANSPORT_TCP) || defined(TRANSPORT_MEMFD)
+#define TRANSPORT_SOCKET
+#ifndef SEND_BATCH
+#define SEND_BATCH 8        /* writev 한 번에 보낼 chunk 수 */
+#endif
+#ifndef SOCK_BUF
+#define SOCK_BUF 0          /* SO_SNDBUF/SO_RCVBUF byte, 0 이면 kernel 기본값 */
+#endif
+#ifndef SOCK_NODELAY
+#define SOCK_NODELAY 1      /* TCP_NODELAY */
+#endif
+#ifndef TCP_PORT
+#define TCP_PORT 15234
+#endif
+#ifndef UNIX_PATH
+#define UNIX_PATH "raid_server.sock"
+#endif
+#endif
 
 /* ===================== MSG ===================== */
+struct msg_hdr {
+    long long send_ns;      /* msgsnd 직전 CLOCK_MONOTONIC */
+    int sm;
+    int chunk;              /* SM domain 안에서의 chunk 번호 */
+    int seq;                /* SM 별 송신 순번 */
+    int pad;
+};
+
 struct msgbuf {
     long mtype;
+    struct msg_hdr hdr;
     int data[CHUNK_INT];
 };
 
+#define MSG_SIZE (sizeof(struct msgbuf) - sizeof(long))
+#define FRAME_END (-1)      /* hdr.chunk: SM 의 frame 전송 끝 (INCREMENTAL) */
+#define FRAME_SEGS (-2)     /* hdr.chunk: data 가 segment 묶음, hdr.pad 는 segment 수 */
+
+/* SM domain 을 통째로 넘기는 전송 (memfd, splice) 의 header */
+struct domain_msg {
+    long mtype;
+    struct msg_hdr hdr;
+    long long bytes;
+};
+
 /* ===================== TIME ===================== */
 #define GET_DURATION(s,e) \
  ((e.tv_sec - s.tv_sec) + (e.tv_usec - s.tv_usec)/1000000.0)
 
+/* 프로세스 간 비교 가능한 timestamp (ns) */
+long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* 이 process 가 쓴 CPU 시간 (user + sys, sec) */
+double cpu_seconds(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+           ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+/* ===================== LATENCY HISTOGRAM ===================== */
+/*
+ * HDR 방식 log-linear histogram: 2 의 거듭제곱 구간마다 HIST_SUB 개 bucket.
+ * 값의 상대 오차는 1/HIST_SUB 이내이고 크기는 고정이라 shared memory 에 둔다.
+ */
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (64 * HIST_SUB)
+
+enum { HOP_QUEUE, HOP_WRITE, HOP_E2E, HOP_COUNT };
+
+struct lat_hist {
+    long count[HIST_BUCKETS];
+    long total;
+};
+
+static int hist_index(long long v) {
+    int exp;
+
+    if (v < HIST_SUB) return v < 0 ? 0 : (int)v;
+    exp = 63 - __builtin_clzll((unsigned long long)v) - HIST_SUB_BITS;
+    return (exp + 1) * HIST_SUB + (int)((v >> exp) - HIST_SUB);
+}
+
+/* bucket idx 의 상한 값 */
+static long long hist_value(int idx) {
+    int exp = idx / HIST_SUB - 1;
+
+    if (exp < 0) return idx;
+    return ((long long)(HIST_SUB + idx % HIST_SUB + 1) << exp) - 1;
+}
+
+void hist_add(struct lat_hist *h, long long v) {
+    h->count[hist_index(v)]++;
+    h->total++;
+}
+
+long long hist_percentile(const struct lat_hist *h, double p) {
+    long target = (long)(p * h->total + 0.999999);
+    long acc = 0;
+    int i;
+
+    if (target < 1) target = 1;
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        acc += h->count[i];
+        if (acc >= target) return hist_value(i);
+    }
+    return 0;
+}
+
 /* ===================== SEM ===================== */
 union semun { int val; };
 
@@ -51,170 +535,3848 @@ void sem_post_s(int id) {
     semop(id, &v, 1);
 }
 
-/* ===================== SERVER ===================== */
-void server_run(double *server_times) {
-    int msqid;
-    struct msgbuf msg;
-    FILE* raid[4];
-    char fn[32];
+/* semaphore set 의 num 번째에 op 만큼 더하기 (op < 0 이면 대기) */
+void sem_op_n(int id, int num, int op) {
+    struct sembuf b;
+    b.sem_num = num;
+    b.sem_op = op;
+    b.sem_flg = 0;
+    semop(id, &b, 1);
+}
+
+/* ===================== TRANSPORT ===================== */
+/*
+ * client → server 채널. 기본은 SysV message queue (MSG_KEY),
+ * -DTRANSPORT_UNIX / -DTRANSPORT_TCP 이면 stream socket 위에 struct msgbuf 를 그대로 보낸다.
+ * client 는 SEND_BATCH 개씩 모아 writev 한 번으로 보내고, server 는 poll 로 연결들을 돌며
+ * 연결마다 받은 byte 를 모아 msgbuf 단위로 꺼낸다. (-DTRANSPORT_MEMFD 는 아래 참고)
+ * server 가 여럿이면 server 마다 queue/socket 이 따로 있고, client 는 chunk 의
+ * stripe 주소 (disk) 로 server 를 골라 보낸다.
+ */
+
+/* SM 의 chunk 가 놓이는 disk 와 그 disk 를 가진 server */
+int stripe_disk(int sm) { return sm % 4; }
+int stripe_server(int sm) { return stripe_disk(sm) % NUM_SERVERS; }
+
+#ifdef TRANSPORT_SOCKET
+#define MAX_CONN (2 * LOGICAL_SM + 2)
+#define RX_BUF (SEND_BATCH * sizeof(struct msgbuf))
+
+struct transport {
+    int server;
+    int nfd;                        /* pfd[0] 은 listen socket */
+    struct pollfd pfd[MAX_CONN];
+    char *buf[MAX_CONN];
+    int head[MAX_CONN], fill[MAX_CONN];
+};
+
+/* client 쪽: server 마다 연결 하나와 송신 batch */
+struct chan {
+    int fd[NUM_SERVERS];
+    int count[NUM_SERVERS];
+    struct msgbuf batch[NUM_SERVERS][SEND_BATCH];
+};
+
+void sock_tune(int fd) {
+    (void)fd;
+#ifdef TRANSPORT_TCP
+    int one = SOCK_NODELAY;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#endif
+#if SOCK_BUF > 0
+    {
+        int sz = SOCK_BUF;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz));
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof(sz));
+    }
+#endif
+}
+
+#ifdef TRANSPORT_MEMFD
+#define SOCK_KIND SOCK_SEQPACKET    /* message 경계 = domain 하나 */
+#else
+#define SOCK_KIND SOCK_STREAM
+#endif
+
+#ifdef SOCK_UNIX
+#define SOCK_FAMILY AF_UNIX
+typedef struct sockaddr_un sock_addr_t;
+void sock_addr(sock_addr_t *a, int server) {
+    memset(a, 0, sizeof(*a));
+    a->sun_family = AF_UNIX;
+    snprintf(a->sun_path, sizeof(a->sun_path), "%s.%d", UNIX_PATH, server);
+}
+#else
+#define SOCK_FAMILY AF_INET
+typedef struct sockaddr_in sock_addr_t;
+void sock_addr(sock_addr_t *a, int server) {
+    memset(a, 0, sizeof(*a));
+    a->sin_family = AF_INET;
+    a->sin_port = htons(TCP_PORT + server);
+    a->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+#endif
+
+void transport_listen(struct transport *t, int server) {
+    sock_addr_t a;
+    int fd, one = 1;
+
+    sock_addr(&a, server);
+    fd = socket(SOCK_FAMILY, SOCK_KIND, 0);
+    if (fd < 0) { perror("socket(server)"); exit(1); }
+#ifdef SOCK_UNIX
+    unlink(a.sun_path);
+#endif
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&a, sizeof(a)) < 0) { perror("bind"); exit(1); }
+    if (listen(fd, MAX_CONN) < 0) { perror("listen"); exit(1); }
+    t->pfd[0].fd = fd;
+    t->pfd[0].events = POLLIN;
+    t->nfd = 1;
+    t->server = server;
+}
+
+/* 다음 msgbuf 하나를 받을 때까지 대기 */
+void transport_recv(struct transport *t, struct msgbuf *msg) {
+    int i, fd;
+    ssize_t n;
+
+    while (1) {
+        for (i = 1; i < t->nfd; i++) {
+            if (t->fill[i] - t->head[i] >= (int)sizeof(struct msgbuf)) {
+                memcpy(msg, t->buf[i] + t->head[i], sizeof(struct msgbuf));
+                t->head[i] += sizeof(struct msgbuf);
+                return;
+            }
+        }
+        if (poll(t->pfd, t->nfd, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll"); exit(1);
+        }
+        if ((t->pfd[0].revents & POLLIN) && t->nfd < MAX_CONN) {
+            fd = accept(t->pfd[0].fd, NULL, NULL);
+            if (fd < 0) { perror("accept"); exit(1); }
+            sock_tune(fd);
+            t->pfd[t->nfd].fd = fd;
+            t->pfd[t->nfd].events = POLLIN;
+            t->buf[t->nfd] = malloc(RX_BUF);
+            t->head[t->nfd] = t->fill[t->nfd] = 0;
+            t->nfd++;
+        }
+        for (i = 1; i < t->nfd; i++) {
+            if (!(t->pfd[i].revents & (POLLIN | POLLHUP)) || t->pfd[i].fd < 0) continue;
+            if (t->head[i] > 0) {
+                memmove(t->buf[i], t->buf[i] + t->head[i], t->fill[i] - t->head[i]);
+                t->fill[i] -= t->head[i];
+                t->head[i] = 0;
+            }
+            n = read(t->pfd[i].fd, t->buf[i] + t->fill[i], RX_BUF - t->fill[i]);
+            if (n < 0) { perror("read(socket)"); exit(1); }
+            if (n == 0) {           /* client 종료: poll 대상에서 제외 */
+                close(t->pfd[i].fd);
+                t->pfd[i].fd = -1;
+                continue;
+            }
+            t->fill[i] += n;
+        }
+    }
+}
+
+void transport_close(struct transport *t) {
     int i;
-    int total_msgs;
-    struct timeval c2s_s, c2s_e, io_s, io_e;
-    double c2s_time = 0, io_time = 0;
-    int sm, disk;
-    
-    msqid = msgget(MSG_KEY, IPC_CREAT | 0666);
-    if (msqid == -1) { perror("msgget(server)"); exit(1); }
+#ifdef SOCK_UNIX
+    sock_addr_t a;
+#endif
 
-    for (i = 0; i < 4; i++) {
-        sprintf(fn, "raid_disk%d.bin", i);
-        raid[i] = fopen(fn, "wb");
-        if (!raid[i]) { perror("fopen raid_disk"); exit(1); }
+    for (i = 0; i < t->nfd; i++) {
+        if (t->pfd[i].fd >= 0) close(t->pfd[i].fd);
+        if (i > 0) free(t->buf[i]);
+    }
+#ifdef SOCK_UNIX
+    sock_addr(&a, t->server);
+    unlink(a.sun_path);
+#endif
+}
+
+/*
+ * server s 에 처음 보낼 때 연결 (listen 전이면 잠시 후 재시도).
+ * server 는 자기 몫을 다 받으면 socket 을 닫고 지우므로, 보낼 것이 없는
+ * server 에 미리 연결하면 늦게 도착한 client 가 ENOENT 로 죽는다.
+ */
+int chan_connect(struct chan *ch, int s) {
+    sock_addr_t a;
+    int fd, tries;
+
+    if (ch->fd[s] >= 0) return ch->fd[s];
+    sock_addr(&a, s);
+    for (tries = 0; ; tries++) {
+        fd = socket(SOCK_FAMILY, SOCK_KIND, 0);
+        if (fd < 0) { perror("socket(client)"); exit(1); }
+        sock_tune(fd);
+        if (connect(fd, (struct sockaddr *)&a, sizeof(a)) == 0) break;
+        close(fd);
+        if ((errno != ECONNREFUSED && errno != ENOENT) || tries > 5000) {
+            perror("connect"); exit(1);
+        }
+        usleep(1000);
+    }
+    ch->fd[s] = fd;
+    return fd;
+}
+
+void chan_open(struct chan *ch) {
+    int s;
+
+    for (s = 0; s < NUM_SERVERS; s++) {
+        ch->fd[s] = -1;
+        ch->count[s] = 0;
+    }
+}
+
+/* server s 로 모인 batch 를 writev 로 한꺼번에 (부분 전송은 이어서) */
+void chan_flush_to(struct chan *ch, int s) {
+    struct iovec iov[SEND_BATCH];
+    int i, first = 0, cnt = ch->count[s];
+    ssize_t n;
+
+    for (i = 0; i < cnt; i++) {
+        iov[i].iov_base = &ch->batch[s][i];
+        iov[i].iov_len = sizeof(struct msgbuf);
+    }
+    while (first < cnt) {
+        n = writev(chan_connect(ch, s), &iov[first], cnt - first);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("writev"); exit(1);
+        }
+        while (first < cnt && n >= (ssize_t)iov[first].iov_len) {
+            n -= iov[first].iov_len;
+            first++;
+        }
+        if (n > 0) {
+            iov[first].iov_base = (char *)iov[first].iov_base + n;
+            iov[first].iov_len -= n;
+        }
+    }
+    ch->count[s] = 0;
+}
+
+void chan_send_to(struct chan *ch, int s, const struct msgbuf *msg) {
+    ch->batch[s][ch->count[s]++] = *msg;
+    if (ch->count[s] == SEND_BATCH) chan_flush_to(ch, s);
+}
+
+void chan_flush(struct chan *ch) {
+    int s;
+
+    for (s = 0; s < NUM_SERVERS; s++) chan_flush_to(ch, s);
+}
+
+void chan_close(struct chan *ch) {
+    int s;
+
+    chan_flush(ch);
+    for (s = 0; s < NUM_SERVERS; s++)
+        if (ch->fd[s] >= 0) close(ch->fd[s]);
+}
+
+#ifdef TRANSPORT_MEMFD
+/*
+ * memfd 전송: client 는 ord domain 을 memfd 에 직접 재정렬해 넣고, 쓰기를 봉인한 뒤
+ * fd 만 SCM_RIGHTS 로 넘긴다. server 는 읽기 전용으로 mmap 해 바로 pwrite.
+ * payload 는 process 사이에서 한 번도 복사되지 않는다 (SOCK_SEQPACKET 한 message = domain 하나).
+ */
+/* bytes 크기 memfd 를 만들어 쓰기용으로 map */
+int *domain_alloc(size_t bytes, int *fd) {
+    int *p;
+
+    *fd = syscall(SYS_memfd_create, "ord_domain", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (*fd < 0) { perror("memfd_create"); exit(1); }
+    if (ftruncate(*fd, bytes) < 0) { perror("ftruncate memfd"); exit(1); }
+    p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if (p == MAP_FAILED) { perror("mmap memfd"); exit(1); }
+    return p;
+}
+
+/* mapping 을 풀고 크기/내용을 봉인한 뒤 domain 을 담당 server 로 넘긴다 */
+void send_domain(struct chan *ch, int sm, int fd, int *buf, size_t bytes) {
+    struct domain_msg dm;
+    struct msghdr mh;
+    struct iovec iov;
+    struct cmsghdr *cm;
+    union { char buf[CMSG_SPACE(sizeof(int))]; struct cmsghdr align; } ctl;
+
+    munmap(buf, bytes);
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+        perror("F_ADD_SEALS"); exit(1);
+    }
+
+    memset(&dm, 0, sizeof(dm));
+    dm.mtype = sm + 1;
+    dm.hdr.sm = sm;
+    dm.bytes = bytes;
+    iov.iov_base = &dm;
+    iov.iov_len = sizeof(dm);
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctl.buf;
+    mh.msg_controllen = sizeof(ctl.buf);
+    cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+
+    dm.hdr.send_ns = now_ns();
+    if (sendmsg(chan_connect(ch, stripe_server(sm)), &mh, 0) != (ssize_t)sizeof(dm)) {
+        perror("sendmsg(SCM_RIGHTS)"); exit(1);
+    }
+    close(fd);
+}
+
+/* 다음 domain 하나의 header 와 fd 를 받을 때까지 대기 */
+void transport_recv_domain(struct transport *t, struct domain_msg *dm, int *fd) {
+    struct msghdr mh;
+    struct iovec iov;
+    struct cmsghdr *cm;
+    union { char buf[CMSG_SPACE(sizeof(int))]; struct cmsghdr align; } ctl;
+    int i, c;
+    ssize_t n;
+
+    while (1) {
+        if (poll(t->pfd, t->nfd, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll"); exit(1);
+        }
+        if ((t->pfd[0].revents & POLLIN) && t->nfd < MAX_CONN) {
+            c = accept(t->pfd[0].fd, NULL, NULL);
+            if (c < 0) { perror("accept"); exit(1); }
+            t->pfd[t->nfd].fd = c;
+            t->pfd[t->nfd].events = POLLIN;
+            t->buf[t->nfd] = NULL;
+            t->nfd++;
+        }
+        for (i = 1; i < t->nfd; i++) {
+            if (!(t->pfd[i].revents & (POLLIN | POLLHUP)) || t->pfd[i].fd < 0) continue;
+            iov.iov_base = dm;
+            iov.iov_len = sizeof(*dm);
+            memset(&mh, 0, sizeof(mh));
+            mh.msg_iov = &iov;
+            mh.msg_iovlen = 1;
+            mh.msg_control = ctl.buf;
+            mh.msg_controllen = sizeof(ctl.buf);
+            n = recvmsg(t->pfd[i].fd, &mh, 0);
+            if (n < 0) { perror("recvmsg"); exit(1); }
+            if (n == 0) {
+                close(t->pfd[i].fd);
+                t->pfd[i].fd = -1;
+                continue;
+            }
+            cm = CMSG_FIRSTHDR(&mh);
+            if (n != (ssize_t)sizeof(*dm) || !cm || cm->cmsg_type != SCM_RIGHTS) {
+                fprintf(stderr, "bad domain message\n"); exit(1);
+            }
+            memcpy(fd, CMSG_DATA(cm), sizeof(int));
+            return;
+        }
+    }
+}
+#endif
+#elif defined(TRANSPORT_SPLICE)
+/*
+ * pipe 전송: disk 마다 pipe 하나 (main 이 fork 전에 만든다).
+ * client 는 disk lock 을 잡고 domain_msg header 를 write 한 뒤 ord page 들을 vmsplice,
+ * server 는 header 를 읽고 payload 를 pipe 에서 raid 파일의 stripe 위치로 바로 splice.
+ * payload 는 server user space 를 거치지 않는다.
+ */
+static int splice_pipe[4][2];
+static int splice_lock;             /* semaphore set, disk 마다 하나 (writer 직렬화) */
+
+/* glibc 는 splice/vmsplice 를 _GNU_SOURCE 에서만 선언하므로 syscall 로 */
+ssize_t sys_splice(int fd_in, long long *off_in, int fd_out, long long *off_out,
+                   size_t len, unsigned int flags) {
+    return syscall(SYS_splice, fd_in, off_in, fd_out, off_out, len, flags);
+}
+
+ssize_t sys_vmsplice(int fd, const struct iovec *iov, unsigned long n, unsigned int flags) {
+    return syscall(SYS_vmsplice, fd, iov, n, flags);
+}
+
+void splice_init(void) {
+    union semun arg;
+    int d;
+
+    splice_lock = semget(IPC_PRIVATE, 4, IPC_CREAT | 0666);
+    arg.val = 1;
+    for (d = 0; d < 4; d++) {
+        if (pipe(splice_pipe[d]) < 0) { perror("pipe"); exit(1); }
+        /* domain 하나가 pipe 에 통째로 들어가도록 (실패하면 기본 크기로) */
+        fcntl(splice_pipe[d][1], F_SETPIPE_SZ, SPLICE_PIPE_SZ);
+        semctl(splice_lock, d, SETVAL, arg);
+    }
+}
+
+void splice_cleanup(void) {
+    int d;
+
+    for (d = 0; d < 4; d++) {
+        close(splice_pipe[d][0]);
+        close(splice_pipe[d][1]);
+    }
+    semctl(splice_lock, 0, IPC_RMID);
+}
+
+struct transport {
+    int server;
+};
+
+struct chan {
+    int fd[NUM_SERVERS];
+};
+
+void transport_listen(struct transport *t, int server) { t->server = server; }
+
+void transport_close(struct transport *t) { (void)t; }
+
+/* 자기 disk pipe 중 header 가 도착한 것 하나를 골라 header 를 읽는다 */
+void transport_recv_pipe(struct transport *t, struct domain_msg *dm, int *disk) {
+    struct pollfd pfd[4];
+    int owner[4], np = 0, d, i;
+    size_t got;
+    ssize_t n;
+
+    for (d = 0; d < 4; d++) {
+        if (d % NUM_SERVERS != t->server) continue;
+        pfd[np].fd = splice_pipe[d][0];
+        pfd[np].events = POLLIN;
+        owner[np++] = d;
+    }
+    while (1) {
+        if (poll(pfd, np, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll(pipe)"); exit(1);
+        }
+        for (i = 0; i < np; i++) {
+            if (!(pfd[i].revents & POLLIN)) continue;
+            for (got = 0; got < sizeof(*dm); got += n) {
+                n = read(pfd[i].fd, (char *)dm + got, sizeof(*dm) - got);
+                if (n <= 0) { perror("read(pipe header)"); exit(1); }
+            }
+            *disk = owner[i];
+            return;
+        }
+    }
+}
+
+/* SM domain 을 disk pipe 로 vmsplice (page 참조만 넘기므로 buf 는 이후 수정하지 않는다) */
+void send_domain_pipe(int sm, int *buf, size_t bytes) {
+    struct domain_msg dm;
+    struct iovec iov;
+    int disk = stripe_disk(sm);
+    ssize_t n;
+
+    memset(&dm, 0, sizeof(dm));
+    dm.mtype = sm + 1;
+    dm.hdr.sm = sm;
+    dm.bytes = bytes;
+    iov.iov_base = buf;
+    iov.iov_len = bytes;
+
+    sem_op_n(splice_lock, disk, -1);
+    dm.hdr.send_ns = now_ns();
+    if (write(splice_pipe[disk][1], &dm, sizeof(dm)) != (ssize_t)sizeof(dm)) {
+        perror("write(pipe header)"); exit(1);
+    }
+    while (iov.iov_len > 0) {
+        n = sys_vmsplice(splice_pipe[disk][1], &iov, 1, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("vmsplice"); exit(1);
+        }
+        iov.iov_base = (char *)iov.iov_base + n;
+        iov.iov_len -= n;
+    }
+    sem_op_n(splice_lock, disk, 1);
+}
+
+/* page 경계에 맞춘 ord buffer (vmsplice 가 page 단위로 참조) */
+int *domain_alloc_pages(size_t bytes) {
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) { perror("mmap ord"); exit(1); }
+    return p;
+}
+
+void chan_open(struct chan *ch) { (void)ch; }
+void chan_send_to(struct chan *ch, int s, const struct msgbuf *msg) { (void)ch; (void)s; (void)msg; }
+void chan_flush(struct chan *ch) { (void)ch; }
+void chan_close(struct chan *ch) { (void)ch; }
+#else
+/* server s 의 queue 는 MSG_KEY + 0x10 * s (CTRL_KEY 와 겹치지 않게) */
+#define SERVER_KEY(s) (MSG_KEY + 0x10 * (s))
+
+struct transport {
+    int msqid;
+};
+
+struct chan {
+    int fd[NUM_SERVERS];
+};
+
+void transport_listen(struct transport *t, int server) {
+    t->msqid = msgget(SERVER_KEY(server), IPC_CREAT | 0666);
+    if (t->msqid == -1) { perror("msgget(server)"); exit(1); }
+}
+
+void transport_recv(struct transport *t, struct msgbuf *msg) {
+    if (msgrcv(t->msqid, msg, MSG_SIZE, 0, 0) == -1) {
+        perror("msgrcv"); exit(1);
+    }
+}
+
+void transport_close(struct transport *t) {
+    msgctl(t->msqid, IPC_RMID, NULL);
+}
+
+void chan_open(struct chan *ch) {
+    int s;
+
+    for (s = 0; s < NUM_SERVERS; s++) ch->fd[s] = msgget(SERVER_KEY(s), 0666);
+}
+
+void chan_send_to(struct chan *ch, int s, const struct msgbuf *msg) {
+    msgsnd(ch->fd[s], msg, MSG_SIZE, 0);
+}
+
+void chan_flush(struct chan *ch) { (void)ch; }
+
+void chan_close(struct chan *ch) { (void)ch; }
+#endif
+
+/* chunk 를 stripe 주소의 server 로 */
+void chan_send(struct chan *ch, const struct msgbuf *msg) {
+    chan_send_to(ch, stripe_server((int)msg->mtype - 1), msg);
+}
+
+/* ===================== STRIPE COMPRESSION ===================== */
+/*
+ * -DRAID_COMPRESS: chunk (CHUNK_INT 개) 하나를 block 하나로 압축해 RAID 에 기록.
+ *   delta   : d[i] = v[i] - v[i-4]   (4 lane 단위라 SIMD 로 그대로 계산/복원)
+ *   FOR     : u[i] = d[i] - min(d)   → 모두 bits 비트 이하
+ *   packing : 128 개씩 lane 별 vertical bit-packing (SIMD-BP128 형식)
+ * block = cblock_hdr + 2 * 4 * bits 개 word. scalar/SSE2 경로는 같은 형식을 만든다.
+ * disk 별 raid_disk%d.idx 에 (sm, chunk, offset, size) 를 남겨 stripe 단위 random access.
+ */
+#ifdef RAID_COMPRESS
+#define CBLOCK_MAX_WORDS (CHUNK_INT + 8)
+
+struct cblock_hdr {
+    int base[4];        /* v[0..3] */
+    int min_delta;
+    int bits;
+};
+
+struct cblock_index {
+    int sm;
+    int chunk;
+    long long offset;   /* disk 파일 안의 byte offset */
+    int size;           /* header 포함 byte 수 */
+    int pad;
+};
+
+int bits_needed(unsigned int v) { return v ? 32 - __builtin_clz(v) : 0; }
+
+#if defined(__SSE2__)
+/* 128 개 (32 vector) 를 lane 별 b bit 로 packing → out 에 b 개 vector */
+void pack128(const unsigned int *in, unsigned int *out, int b) {
+    __m128i acc = _mm_setzero_si128(), v;
+    int i, shift = 0;
+
+    if (b == 0) return;
+    for (i = 0; i < 32; i++) {
+        v = _mm_loadu_si128((const __m128i *)(in + 4 * i));
+        acc = _mm_or_si128(acc, _mm_sll_epi32(v, _mm_cvtsi32_si128(shift)));
+        shift += b;
+        if (shift >= 32) {
+            _mm_storeu_si128((__m128i *)out, acc);
+            out += 4;
+            shift -= 32;
+            acc = shift ? _mm_srl_epi32(v, _mm_cvtsi32_si128(b - shift))
+                        : _mm_setzero_si128();
+        }
+    }
+}
+
+void unpack128(const unsigned int *in, unsigned int *out, int b) {
+    __m128i mask, w, v;
+    int i, shift = 0;
+
+    if (b == 0) { memset(out, 0, sizeof(int) * 128); return; }
+    mask = _mm_set1_epi32(b == 32 ? -1 : (int)((1u << b) - 1));
+    w = _mm_loadu_si128((const __m128i *)in);
+    for (i = 0; i < 32; i++) {
+        v = _mm_srl_epi32(w, _mm_cvtsi32_si128(shift));
+        shift += b;
+        if (shift >= 32) {
+            in += 4;
+            shift -= 32;
+            if (i < 31) w = _mm_loadu_si128((const __m128i *)in);
+            if (shift)
+                v = _mm_or_si128(v, _mm_sll_epi32(w, _mm_cvtsi32_si128(b - shift)));
+        }
+        _mm_storeu_si128((__m128i *)(out + 4 * i), _mm_and_si128(v, mask));
+    }
+}
+#else
+void pack128(const unsigned int *in, unsigned int *out, int b) {
+    int i, l, o, shift;
+    unsigned int acc, v;
+
+    if (b == 0) return;
+    for (l = 0; l < 4; l++) {
+        acc = 0; shift = 0; o = 0;
+        for (i = 0; i < 32; i++) {
+            v = in[4 * i + l];
+            acc |= v << shift;
+            shift += b;
+            if (shift >= 32) {
+                out[4 * o++ + l] = acc;
+                shift -= 32;
+                acc = shift ? v >> (b - shift) : 0;
+            }
+        }
+    }
+}
+
+void unpack128(const unsigned int *in, unsigned int *out, int b) {
+    int i, l, o, shift;
+    unsigned int mask, w, v;
+
+    if (b == 0) { memset(out, 0, sizeof(int) * 128); return; }
+    mask = b == 32 ? ~0u : (1u << b) - 1;
+    for (l = 0; l < 4; l++) {
+        shift = 0; o = 0; w = in[l];
+        for (i = 0; i < 32; i++) {
+            v = w >> shift;
+            shift += b;
+            if (shift >= 32) {
+                o++;
+                shift -= 32;
+                if (i < 31) w = in[4 * o + l];
+                if (shift) v |= w << (b - shift);
+            }
+            out[4 * i + l] = v & mask;
+        }
+    }
+}
+#endif
+
+/* src CHUNK_INT 개 → out (word 단위), 반환값은 byte 수 */
+int cblock_encode(const int *src, unsigned int *out) {
+    struct cblock_hdr *h = (struct cblock_hdr *)out;
+    unsigned int u[CHUNK_INT];
+    unsigned int *body = out + sizeof(struct cblock_hdr) / sizeof(int);
+    int i, b, mn, mx;
+#if defined(__SSE2__)
+    __m128i d, lo, hi, gt;
+
+    lo = _mm_setzero_si128(); hi = lo;
+    _mm_storeu_si128((__m128i *)u, lo);
+    for (i = 4; i < CHUNK_INT; i += 4) {
+        d = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(src + i)),
+                          _mm_loadu_si128((const __m128i *)(src + i - 4)));
+        _mm_storeu_si128((__m128i *)(u + i), d);
+        gt = _mm_cmpgt_epi32(lo, d);    /* SSE2 에는 min/max_epi32 가 없다 */
+        lo = _mm_or_si128(_mm_and_si128(gt, d), _mm_andnot_si128(gt, lo));
+        gt = _mm_cmpgt_epi32(d, hi);
+        hi = _mm_or_si128(_mm_and_si128(gt, d), _mm_andnot_si128(gt, hi));
+    }
+    {
+        int l4[4], h4[4];
+        _mm_storeu_si128((__m128i *)l4, lo);
+        _mm_storeu_si128((__m128i *)h4, hi);
+        mn = l4[0]; mx = h4[0];
+        for (i = 1; i < 4; i++) {
+            if (l4[i] < mn) mn = l4[i];
+            if (h4[i] > mx) mx = h4[i];
+        }
+    }
+    lo = _mm_set1_epi32(mn);
+    for (i = 0; i < CHUNK_INT; i += 4)
+        _mm_storeu_si128((__m128i *)(u + i),
+                         _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(u + i)), lo));
+#else
+    int d;
+
+    mn = 0; mx = 0;
+    for (i = 0; i < 4; i++) u[i] = 0;
+    for (i = 4; i < CHUNK_INT; i++) {
+        d = (int)((unsigned int)src[i] - (unsigned int)src[i - 4]);
+        u[i] = (unsigned int)d;
+        if (d < mn) mn = d;
+        if (d > mx) mx = d;
+    }
+    for (i = 0; i < CHUNK_INT; i++) u[i] -= (unsigned int)mn;
+#endif
+    b = bits_needed((unsigned int)mx - (unsigned int)mn);
+    for (i = 0; i < 4; i++) h->base[i] = src[i];
+    h->min_delta = mn;
+    h->bits = b;
+    for (i = 0; i < CHUNK_INT; i += 128)
+        pack128(u + i, body + (i / 128) * 4 * b, b);
+    return (int)sizeof(struct cblock_hdr) + (CHUNK_INT / 128) * 16 * b;
+}
+
+/* cblock_encode 의 역: in → dst CHUNK_INT 개 */
+void cblock_decode(const unsigned int *in, int *dst) {
+    const struct cblock_hdr *h = (const struct cblock_hdr *)in;
+    const unsigned int *body = in + sizeof(struct cblock_hdr) / sizeof(int);
+    unsigned int u[CHUNK_INT];
+    int i;
+#if defined(__SSE2__)
+    __m128i acc, mn;
+#endif
+
+    for (i = 0; i < CHUNK_INT; i += 128)
+        unpack128(body + (i / 128) * 4 * h->bits, u + i, h->bits);
+#if defined(__SSE2__)
+    acc = _mm_loadu_si128((const __m128i *)h->base);
+    mn = _mm_set1_epi32(h->min_delta);
+    _mm_storeu_si128((__m128i *)dst, acc);
+    for (i = 4; i < CHUNK_INT; i += 4) {
+        acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_loadu_si128((const __m128i *)(u + i)), mn));
+        _mm_storeu_si128((__m128i *)(dst + i), acc);
+    }
+#else
+    for (i = 0; i < 4; i++) dst[i] = h->base[i];
+    for (i = 4; i < CHUNK_INT; i++)
+        dst[i] = (int)((unsigned int)dst[i - 4] + u[i] + (unsigned int)h->min_delta);
+#endif
+}
+
+/*
+ * read path: idx 를 따라 모든 block 을 다시 읽어 복원하고 값 검증.
+ * decode 에 걸린 시간만 *dec_time 에, 검증 실패 block 수는 *bad 에 누적.
+ * 복원 byte 수를 돌려준다.
+ */
+long long raid_read_back(const char *dir, double *dec_time, long *bad) {
+    struct cblock_index e;
+    unsigned int blk[CBLOCK_MAX_WORDS];
+    int out[CHUNK_INT];
+    char fn[64];
+    FILE *idx;
+    int fd, disk, i;
+    long long bytes = 0, t0;
+
+    for (disk = 0; disk < 4; disk++) {
+        sprintf(fn, "%s/raid_disk%d.idx", dir, disk);
+        idx = fopen(fn, "rb");
+        sprintf(fn, "%s/raid_disk%d.bin", dir, disk);
+        fd = open(fn, O_RDONLY);
+        if (!idx || fd < 0) { perror("open raid index"); exit(1); }
+        while (fread(&e, sizeof(e), 1, idx) == 1) {
+            if (pread(fd, blk, e.size, e.offset) != e.size) { perror("pread raid"); exit(1); }
+            t0 = now_ns();
+            cblock_decode(blk, out);
+            *dec_time += (now_ns() - t0) / 1e9;
+            for (i = 0; i < CHUNK_INT; i++)
+                if (out[i] != (e.chunk / MSGS_PER_SM) * DATA_SIZE + e.sm * LOGICAL_CHUNK +
+                              (e.chunk % MSGS_PER_SM) * CHUNK_INT + i) { (*bad)++; break; }
+            bytes += sizeof(int) * CHUNK_INT;
+        }
+        fclose(idx);
+        close(fd);
+    }
+    return bytes;
+}
+#endif
+
+/* ===================== SERVER ===================== */
+/* server_times 슬롯 */
+enum { ST_RECV, ST_IO, ST_ENCODE, ST_RAW_BYTES, ST_DISK_BYTES, ST_CPU,
+       ST_LOG_GROUPS, ST_CKPT, ST_COMPACT, ST_COMPACT_WAIT,
+       ST_EMU_BUSY, ST_EMU_WAIT = ST_EMU_BUSY + 4, ST_EMU_STALLS = ST_EMU_WAIT + 4,
+       ST_EMU_WRITES = ST_EMU_STALLS + 4, ST_EMU_BYTES = ST_EMU_WRITES + 4,
+       ST_EMU_MAXLAT = ST_EMU_BYTES + 4, ST_COUNT = ST_EMU_MAXLAT + 4 };      /* ST_EMU_* 는 disk 별 4 칸 */
+
+#ifdef DISK_EMU
+/* disk 별 흉내 상태 (server process 마다 자기 disk 만 쓴다) */
+struct disk_emu {
+    double rate;            /* byte/ns */
+    double tokens;          /* 음수면 빚: 찰 때까지 기다린다 */
+    long long last_ns;
+    int lat_scale;
+    double busy, wait;      /* sec: 기록 + 지연 전체, 그중 token 대기 */
+    double stalls, writes, bytes;
+    double max_lat;         /* sec: 가장 긴 지연 (stall 포함, token 대기 제외) */
+};
+
+static struct disk_emu disk_emu[4];
+static unsigned int disk_emu_seed = 12345;
+
+void disk_emu_init(void) {
+    int d;
+
+    for (d = 0; d < 4; d++) {
+        disk_emu[d].rate = DISK_MBPS * 1048576.0 / 1e9 / (d == DISK_SLOW ? DISK_SLOW_FACTOR : 1);
+        disk_emu[d].tokens = DISK_BURST;
+        disk_emu[d].last_ns = now_ns();
+        disk_emu[d].lat_scale = d == DISK_SLOW ? DISK_SLOW_FACTOR : 1;
+    }
+}
+
+/* job 단위 통계만 비운다 (bucket 상태는 유지) */
+void disk_emu_reset(void) {
+    int d;
+
+    for (d = 0; d < 4; d++)
+        disk_emu[d].busy = disk_emu[d].wait = disk_emu[d].stalls =
+            disk_emu[d].writes = disk_emu[d].bytes = disk_emu[d].max_lat = 0;
+}
+
+static void sleep_ns(long long ns) {
+    struct timespec ts;
+
+    if (ns <= 0) return;
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) ;
+}
+
+static unsigned int emu_rand(void) {
+    disk_emu_seed = disk_emu_seed * 1103515245 + 12345;
+    return disk_emu_seed >> 8;          /* 하위 bit 는 주기가 짧아 버린다: 24 bit */
+}
+
+/* 기록 하나의 지연 (ns, DISK_LAT_DIST 분포) */
+static long long disk_emu_latency(void) {
+    long long mean = DISK_LAT_US * 1000LL, lat;
+#if DISK_LAT_DIST == 1
+    unsigned int r;
+    int k = 0;
+
+    /* Exp(mean) = mean * ln 2 * (Geom(1/2) + 소수부), 소수부는 균등으로 근사 */
+    while ((r = emu_rand()) == 0) k += 24;
+    k += __builtin_ctz(r);
+    lat = mean * 693 / 1000 * k + (long long)(mean * 693 / 1000) * emu_rand() / (1 << 24);
+#elif DISK_LAT_DIST == 2
+    unsigned int u1 = emu_rand(), u2 = emu_rand();
+
+    /* P(max(U1, U2) < t) = t^2 이므로 P(X > x) = (x_m / x)^2, 평균 2 x_m = mean */
+    lat = (mean / 2) * (1 << 24) / ((u1 > u2 ? u1 : u2) + 1);
+#else
+    lat = mean + emu_rand() % (2 * DISK_JITTER_US * 1000LL + 1);
+#endif
+    return lat < DISK_LAT_MAX_US * 1000LL ? lat : DISK_LAT_MAX_US * 1000LL;
+}
+
+/* t0 에 시작한 bytes 기록 하나를 장치 속도에 맞춰 늦춘다 */
+void disk_emu_io(int disk, double bytes, long long t0) {
+    struct disk_emu *d = &disk_emu[disk];
+    long long now = now_ns(), wait = 0, lat;
+
+    d->tokens += (now - d->last_ns) * d->rate;
+    if (d->tokens > DISK_BURST) d->tokens = DISK_BURST;
+    d->last_ns = now;
+    d->tokens -= bytes;
+    if (d->tokens < 0) wait = (long long)(-d->tokens / d->rate);
+
+    lat = disk_emu_latency() * d->lat_scale;
+#if DISK_STALL_PPM > 0
+    if (emu_rand() % 1000000 < DISK_STALL_PPM) {
+        lat += DISK_STALL_US * 1000LL;
+        d->stalls++;
+    }
+#endif
+    sleep_ns(wait + lat);
+    if (lat / 1e9 > d->max_lat) d->max_lat = lat / 1e9;
+
+    d->busy += (now_ns() - t0) / 1e9;
+    d->wait += wait / 1e9;
+    d->writes++;
+    d->bytes += bytes;
+}
+
+void disk_emu_store(double *server_times) {
+    int d;
+
+    for (d = 0; d < 4; d++) {
+        server_times[ST_EMU_BUSY + d] = disk_emu[d].busy;
+        server_times[ST_EMU_WAIT + d] = disk_emu[d].wait;
+        server_times[ST_EMU_STALLS + d] = disk_emu[d].stalls;
+        server_times[ST_EMU_WRITES + d] = disk_emu[d].writes;
+        server_times[ST_EMU_BYTES + d] = disk_emu[d].bytes;
+        server_times[ST_EMU_MAXLAT + d] = disk_emu[d].max_lat;
+    }
+}
+#endif
+
+#ifdef STORAGE_LOG
+/* log index 항목: chunk (sm, chunk) 가 log 의 offset 에 있다 */
+struct log_index {
+    int sm;
+    int chunk;
+    long long offset;
+};
+#endif
+
+/* RAID disk 4 개와 job 단위 통계, (압축 모드) disk 별 block index */
+struct raid_set {
+    char dir[32];
+    FILE *fp[4];
+    double encode_time;
+    double raw_bytes, disk_bytes;
+    long long pos[4];               /* disk 별 다음 기록 위치 */
+#ifdef RAID_COMPRESS
+    struct cblock_index *idx[4];
+    int nidx[4];
+#endif
+#ifdef STORAGE_LOG
+    int server;
+    int log_fd;
+    char *group;                    /* LOG_ALIGN 정렬된 group buffer */
+    int group_len;
+    long long log_pos;              /* 다음 group 을 쓸 log 위치 */
+    long long log_region;           /* log 절반 하나의 크기 */
+    int log_half;                   /* 이번 job 이 쓰는 절반 */
+    pid_t compactor;                /* 돌고 있는 compactor (없으면 -1) */
+    long groups;
+    struct log_index *lidx;
+    int nlidx;
+#endif
+};
+
+#ifdef STORAGE_LOG
+/* 모은 group 을 log 끝에 한 번에 쓴다. 마지막 group 은 LOG_ALIGN 까지 0 으로 채움 */
+static void log_flush_group(struct raid_set *rs) {
+    int len = (rs->group_len + LOG_ALIGN - 1) / LOG_ALIGN * LOG_ALIGN;
+
+    if (rs->group_len == 0) return;
+    memset(rs->group + rs->group_len, 0, len - rs->group_len);
+    if (pwrite(rs->log_fd, rs->group, len, rs->log_pos) != len) {
+        perror("pwrite raid_log"); exit(1);
+    }
+    rs->log_pos += len;
+    rs->disk_bytes += len;
+    rs->group_len = 0;
+    rs->groups++;
+}
+
+/* chunk 를 group 에 붙이고 index 에 log 위치를 적는다 */
+static void log_append(struct raid_set *rs, const struct msgbuf *msg) {
+    struct log_index *e = &rs->lidx[rs->nlidx++];
+
+    e->sm = msg->hdr.sm;
+    e->chunk = msg->hdr.chunk;
+    e->offset = rs->log_pos + rs->group_len;
+    memcpy(rs->group + rs->group_len, msg->data, sizeof(int) * CHUNK_INT);
+    rs->group_len += sizeof(int) * CHUNK_INT;
+    if (rs->group_len == LOG_GROUP) log_flush_group(rs);
+}
+
+/* checkpoint: 남은 group 을 쓰고 log 를 내린 뒤 index 를 raid_log%d.idx 로 */
+void log_checkpoint(struct raid_set *rs, double *server_times) {
+    struct timeval s, e;
+    char fn[64];
+    FILE *fp;
+
+    gettimeofday(&s, NULL);
+    log_flush_group(rs);
+    if (fdatasync(rs->log_fd) < 0) perror("fdatasync raid_log");
+    sprintf(fn, "%s/raid_log%d.idx", rs->dir, rs->server);
+    fp = fopen(fn, "wb");
+    if (!fp) { perror("fopen raid_log index"); exit(1); }
+    fwrite(&rs->nlidx, sizeof(int), 1, fp);
+    fwrite(rs->lidx, sizeof(struct log_index), rs->nlidx, fp);
+    fclose(fp);
+    gettimeofday(&e, NULL);
+    server_times[ST_LOG_GROUPS] = rs->groups;
+    server_times[ST_CKPT] = GET_DURATION(s, e);
+}
+
+/*
+ * compaction: 이번 job 의 log 절반을 group 단위로 순차로 읽어 chunk 마다 RAID0 stripe
+ * 위치 (disk 안 SM (sm, sm + 4) 순, SM 안 chunk 순) 에 다시 쓴다.
+ */
+static void log_compact(struct raid_set *rs, double *server_times) {
+    struct timeval s, e;
+    long long base, off;
+    ssize_t got;
+    int i;
+
+    gettimeofday(&s, NULL);
+    for (base = rs->log_half * rs->log_region, i = 0; i < rs->nlidx; base += LOG_GROUP) {
+        got = pread(rs->log_fd, rs->group, LOG_GROUP, base);
+        if (got <= 0) { perror("pread raid_log"); exit(1); }
+        for (; i < rs->nlidx && rs->lidx[i].offset < base + got; i++) {
+            off = ((long long)(rs->lidx[i].sm / 4) * BATCH_MSGS + rs->lidx[i].chunk) *
+                  sizeof(int) * CHUNK_INT;
+            if (pwrite(fileno(rs->fp[stripe_disk(rs->lidx[i].sm)]),
+                       rs->group + (rs->lidx[i].offset - base), sizeof(int) * CHUNK_INT, off) !=
+                sizeof(int) * CHUNK_INT) {
+                perror("pwrite raid_disk"); exit(1);
+            }
+        }
+    }
+    gettimeofday(&e, NULL);
+    server_times[ST_COMPACT] = GET_DURATION(s, e);
+}
+
+/* 이전 compactor 가 있으면 끝날 때까지 기다린다 */
+static void log_compact_wait(struct raid_set *rs) {
+    if (rs->compactor > 0) waitpid(rs->compactor, NULL, 0);
+    rs->compactor = -1;
+}
+
+/* checkpoint 뒤: compactor 를 fork 하고 다음 job 은 다른 절반에 쓴다 */
+void log_compact_start(struct raid_set *rs, double *server_times) {
+    struct timeval s, e;
+
+    gettimeofday(&s, NULL);
+    log_compact_wait(rs);           /* 같은 stripe 위치를 쓰므로 compaction 끼리는 순서대로 */
+    gettimeofday(&e, NULL);
+    server_times[ST_COMPACT_WAIT] = GET_DURATION(s, e);
+
+    rs->compactor = fork();
+    if (rs->compactor < 0) { perror("fork compactor"); exit(1); }
+    if (rs->compactor == 0) {
+        log_compact(rs, server_times);
+        exit(0);
+    }
+    rs->log_half = (rs->log_half + 1) % LOG_HALVES;
+}
+#endif
+
+/* 받은 chunk 하나를 disk 에 기록 */
+void raid_write(struct raid_set *rs, int disk, const struct msgbuf *msg) {
+#ifdef DISK_EMU
+    long long emu_t0 = now_ns();
+    double emu_bytes = rs->disk_bytes;
+#endif
+#if defined(STORAGE_LOG)
+    (void)disk;
+    log_append(rs, msg);
+#elif defined(RAID_COMPRESS)
+    unsigned int blk[CBLOCK_MAX_WORDS];
+    struct cblock_index *e;
+    long long t0;
+    int size;
+
+    t0 = now_ns();
+    size = cblock_encode(msg->data, blk);
+    rs->encode_time += (now_ns() - t0) / 1e9;
+
+    fwrite(blk, 1, size, rs->fp[disk]);
+    fflush(rs->fp[disk]);
+    e = &rs->idx[disk][rs->nidx[disk]++];
+    e->sm = msg->hdr.sm;
+    e->chunk = msg->hdr.chunk;
+    e->offset = rs->pos[disk];
+    e->size = size;
+    e->pad = 0;
+    rs->pos[disk] += size;
+    rs->disk_bytes += size;
+#elif defined(INCREMENTAL)
+    /* 고정 stripe 위치에 덮어쓴다: disk 안은 SM (sm, sm + 4) 순, SM 안은 domain 순 */
+    long long base = (long long)(msg->hdr.sm / 4) * LOGICAL_CHUNK;
+    int k;
+
+    if (msg->hdr.chunk != FRAME_SEGS) {
+        if (pwrite(fileno(rs->fp[disk]), msg->data, sizeof(int) * CHUNK_INT,
+                   (base + (long long)msg->hdr.chunk * CHUNK_INT) * sizeof(int)) !=
+            sizeof(int) * CHUNK_INT) {
+            perror("pwrite raid"); exit(1);
+        }
+        rs->disk_bytes += sizeof(int) * CHUNK_INT;
+        rs->raw_bytes += sizeof(int) * CHUNK_INT;
+    }
+    /* segment message 는 실제로 옮긴 segment payload 만 센다 */
+    for (k = 0; msg->hdr.chunk == FRAME_SEGS && k < msg->hdr.pad; k++) {
+        if (pwrite(fileno(rs->fp[disk]), &msg->data[SEGS_PER_MSG + k * DIRTY_TILE],
+                   sizeof(int) * DIRTY_TILE, (base + msg->data[k]) * sizeof(int)) !=
+            sizeof(int) * DIRTY_TILE) {
+            perror("pwrite raid"); exit(1);
+        }
+        rs->disk_bytes += sizeof(int) * DIRTY_TILE;
+        rs->raw_bytes += sizeof(int) * DIRTY_TILE;
+    }
+#else
+    fwrite(msg->data, sizeof(int), CHUNK_INT, rs->fp[disk]);
+    fflush(rs->fp[disk]);
+    rs->pos[disk] += sizeof(int) * CHUNK_INT;
+    rs->disk_bytes += sizeof(int) * CHUNK_INT;
+#endif
+#ifndef INCREMENTAL
+    rs->raw_bytes += sizeof(int) * CHUNK_INT;
+#endif
+#ifdef DISK_EMU
+    disk_emu_io(disk, rs->disk_bytes - emu_bytes, emu_t0);
+#endif
+}
+
+/* job 시작: 모든 disk 를 처음부터 다시 쓴다 */
+void raid_rewind(struct raid_set *rs) {
+    int i;
+
+    rs->encode_time = rs->raw_bytes = rs->disk_bytes = 0;
+#ifdef DISK_EMU
+    disk_emu_reset();
+#endif
+#ifdef STORAGE_LOG
+    rs->group_len = 0;
+    rs->log_pos = rs->log_half * rs->log_region;
+    rs->groups = 0;
+    rs->nlidx = 0;
+#endif
+    for (i = 0; i < 4; i++) {
+        if (!rs->fp[i]) continue;
+        rewind(rs->fp[i]);
+        rs->pos[i] = 0;
+#ifdef RAID_COMPRESS
+        rs->nidx[i] = 0;
+#endif
+    }
+}
+
+#ifdef TRANSPORT_SPLICE
+/* pipe 에 들어온 domain bytes 를 disk 의 stripe 위치 off 에 바로 splice */
+void raid_splice(struct raid_set *rs, int disk, int pipe_rd, long long off, long long bytes) {
+    long long left = bytes;
+    ssize_t n;
+#ifdef DISK_EMU
+    long long emu_t0 = now_ns();
+#endif
+
+    while (left > 0) {
+        n = sys_splice(pipe_rd, NULL, fileno(rs->fp[disk]), &off, left, SPLICE_F_MOVE);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("splice raid"); exit(1);
+        }
+        if (n == 0) { fprintf(stderr, "pipe closed mid-domain\n"); exit(1); }
+        left -= n;
+    }
+    if (off > rs->pos[disk]) rs->pos[disk] = off;
+    rs->raw_bytes += bytes;
+    rs->disk_bytes += bytes;
+#ifdef DISK_EMU
+    disk_emu_io(disk, bytes, emu_t0);
+#endif
+}
+#endif
+
+#ifdef TRANSPORT_MEMFD
+/* 받은 memfd (SM domain 전체) 를 읽기 전용으로 map 해 disk 의 현재 위치에 pwrite */
+void raid_write_fd(struct raid_set *rs, int disk, int fd) {
+    struct stat st;
+    void *p;
+#ifdef DISK_EMU
+    long long emu_t0 = now_ns();
+#endif
+
+    if (!(fcntl(fd, F_GET_SEALS) & F_SEAL_WRITE)) {
+        fprintf(stderr, "memfd is not write-sealed\n"); exit(1);
+    }
+    if (fstat(fd, &st) < 0) { perror("fstat memfd"); exit(1); }
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) { perror("mmap memfd"); exit(1); }
+    if (pwrite(fileno(rs->fp[disk]), p, st.st_size, rs->pos[disk]) != st.st_size) {
+        perror("pwrite raid"); exit(1);
+    }
+    munmap(p, st.st_size);
+    close(fd);
+    rs->pos[disk] += st.st_size;
+    rs->raw_bytes += st.st_size;
+    rs->disk_bytes += st.st_size;
+#ifdef DISK_EMU
+    disk_emu_io(disk, st.st_size, emu_t0);
+#endif
+}
+#endif
+
+#ifdef RAID_COMPRESS
+/* job 이 끝나면 disk 별 block index 를 raid_disk%d.idx 로 기록 */
+void raid_write_index(const struct raid_set *rs) {
+    char fn[64];
+    FILE *fp;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        if (!rs->fp[i]) continue;
+        sprintf(fn, "%s/raid_disk%d.idx", rs->dir, i);
+        fp = fopen(fn, "wb");
+        if (!fp) { perror("fopen raid index"); exit(1); }
+        fwrite(rs->idx[i], sizeof(struct cblock_index), rs->nidx[i], fp);
+        fclose(fp);
+    }
+}
+#endif
+
+/*
+ * 한 job 분량 (LOGICAL_SM * MSGS_PER_SM 개) 의 chunk 를 받아 RAID 파일에 기록.
+ * mtype 이 SM 범위를 벗어나면 종료 요청으로 보고 -1 을 돌려준다.
+ */
+int server_recv_job(struct transport *t, struct raid_set *rs, double *server_times,
+                    struct lat_hist (*hist)[HOP_COUNT]) {
+#if defined(TRANSPORT_MEMFD)
+    struct domain_msg msg;
+    int fd;
+#elif defined(TRANSPORT_SPLICE)
+    struct domain_msg msg;
+    int pipe_disk;
+#else
+    struct msgbuf msg;
+#endif
+    int i;
+    int total_msgs;
+    double cpu0 = cpu_seconds();
+    struct timeval c2s_s, c2s_e, io_s, io_e;
+    double c2s_time = 0, io_time = 0;
+    int sm, disk;
+    long long recv_ns, done_ns;
+
+#if defined(TRANSPORT_MEMFD) || defined(TRANSPORT_SPLICE) || defined(INCREMENTAL)
+    total_msgs = LOGICAL_SM / NUM_SERVERS;                /* SM domain (frame) 당 하나 */
+#else
+    total_msgs = LOGICAL_SM / NUM_SERVERS * BATCH_MSGS;   /* N=64, S=1, K=1: 8 * 2 = 16 */
+#endif
+
+    for (i = 0; i < total_msgs; i++) {
+        gettimeofday(&c2s_s, NULL);
+#if defined(TRANSPORT_MEMFD)
+        transport_recv_domain(t, &msg, &fd);
+#elif defined(TRANSPORT_SPLICE)
+        transport_recv_pipe(t, &msg, &pipe_disk);
+#else
+        transport_recv(t, &msg);
+#endif
+        recv_ns = now_ns();
+        gettimeofday(&c2s_e, NULL);
+        c2s_time += GET_DURATION(c2s_s, c2s_e);
+
+        sm = (int)msg.mtype - 1;
+        if (sm >= LOGICAL_SM) return -1;
+        disk = stripe_disk(sm);
+#ifdef INCREMENTAL
+        /* frame 마다 chunk 수가 다르므로 SM 별 frame 끝 표시만 센다 */
+        if (msg.hdr.chunk == FRAME_END) continue;
+        i--;
+#endif
+
+        gettimeofday(&io_s, NULL);
+#if defined(TRANSPORT_MEMFD)
+        raid_write_fd(rs, disk, fd);
+#elif defined(TRANSPORT_SPLICE)
+        /* 한 disk 의 SM 두 개 (sm, sm + 4) 는 domain 크기 단위 stripe 위치에 */
+        raid_splice(rs, disk, splice_pipe[pipe_disk][0], (long long)(sm / 4) * msg.bytes,
+                    msg.bytes);
+#else
+        raid_write(rs, disk, &msg);
+#endif
+        gettimeofday(&io_e, NULL);
+        io_time += GET_DURATION(io_s, io_e);
+        done_ns = now_ns();
+
+        hist_add(&hist[sm][HOP_QUEUE], recv_ns - msg.hdr.send_ns);
+        hist_add(&hist[sm][HOP_WRITE], done_ns - recv_ns);
+        hist_add(&hist[sm][HOP_E2E], done_ns - msg.hdr.send_ns);
+    }
+
+    /* Store times to shared memory */
+    server_times[ST_RECV] = c2s_time;
+    server_times[ST_IO] = io_time;
+    server_times[ST_ENCODE] = rs->encode_time;
+    server_times[ST_RAW_BYTES] = rs->raw_bytes;
+    server_times[ST_DISK_BYTES] = rs->disk_bytes;
+    server_times[ST_CPU] = cpu_seconds() - cpu0;
+#ifdef DISK_EMU
+    disk_emu_store(server_times);
+#endif
+#ifdef RAID_COMPRESS
+    raid_write_index(rs);
+#endif
+#ifdef STORAGE_LOG
+    log_checkpoint(rs, server_times);
+#endif
+    return 0;
+}
+
+/*
+ * dir 아래 RAID disk 중 server 몫 (d % NUM_SERVERS == server) 만 연다.
+ * passes: 한 job 에서 같은 domain 이 반복 전송되는 횟수 (index 크기)
+ */
+void raid_open(struct raid_set *rs, const char *dir, int server, int passes) {
+    char fn[64];
+    int i;
+
+    snprintf(rs->dir, sizeof(rs->dir), "%s", dir);
+#ifdef DISK_EMU
+    disk_emu_init();
+#endif
+    for (i = 0; i < 4; i++) {
+        rs->fp[i] = NULL;
+        if (i % NUM_SERVERS != server) continue;
+        sprintf(fn, "%s/raid_disk%d.bin", dir, i);
+        rs->fp[i] = fopen(fn, "wb");
+        if (!rs->fp[i]) { perror("fopen raid_disk"); exit(1); }
+#ifdef RAID_COMPRESS
+        /* SM 두 개가 한 disk 를 공유 */
+        rs->idx[i] = malloc(sizeof(struct cblock_index) * 2 * BATCH_MSGS * passes);
+#else
+        (void)passes;
+#endif
+    }
+#ifdef STORAGE_LOG
+    /* 절반마다 job 한 번 분량 + 마지막 group 정렬 여유를 미리 할당 */
+    rs->server = server;
+    sprintf(fn, "%s/raid_log%d.bin", dir, server);
+    rs->log_fd = open(fn, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (rs->log_fd < 0) { perror("open raid_log"); exit(1); }
+    rs->log_region = ((long long)LOGICAL_SM / NUM_SERVERS * BATCH_MSGS * passes * sizeof(int) *
+                      CHUNK_INT + LOG_ALIGN) / LOG_ALIGN * LOG_ALIGN;
+    rs->log_half = 0;
+    rs->compactor = -1;
+    i = posix_fallocate(rs->log_fd, 0, (off_t)rs->log_region * LOG_HALVES);
+    if (i != 0) { errno = i; perror("posix_fallocate raid_log"); }
+    if (posix_memalign((void **)&rs->group, LOG_ALIGN, LOG_GROUP) != 0) {
+        perror("posix_memalign"); exit(1);
+    }
+    rs->lidx = malloc(sizeof(struct log_index) * LOGICAL_SM / NUM_SERVERS * BATCH_MSGS * passes);
+#endif
+    raid_rewind(rs);
+}
+
+void raid_close(struct raid_set *rs) {
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        if (!rs->fp[i]) continue;
+        fclose(rs->fp[i]);
+#ifdef RAID_COMPRESS
+        free(rs->idx[i]);
+#endif
+    }
+#ifdef STORAGE_LOG
+    log_compact_wait(rs);
+    close(rs->log_fd);
+    free(rs->group);
+    free(rs->lidx);
+#endif
+}
+
+void server_open(struct transport *t, struct raid_set *rs, int server) {
+    transport_listen(t, server);
+    raid_open(rs, ".", server, 1);
+}
+
+/* chunk 번호 chunk 의 CHUNK_INT 개를 header 와 함께 전송 */
+void send_chunk(struct chan *ch, int sm, int chunk, const int *src) {
+    static int seq = 0;
+    struct msgbuf msg;
+
+    msg.mtype = sm + 1;
+    msg.hdr.sm = sm;
+    msg.hdr.chunk = chunk;
+    msg.hdr.seq = seq++;
+    msg.hdr.pad = 0;
+    memcpy(msg.data, src, sizeof(int) * CHUNK_INT);
+    msg.hdr.send_ns = now_ns();
+    chan_send(ch, &msg);
+}
+
+void server_close(struct transport *t, struct raid_set *rs) {
+    transport_close(t);
+    raid_close(rs);                 /* STORAGE_LOG: 남은 compactor 를 여기서 기다린다 */
+}
+
+void server_run(int server, double *server_times, struct lat_hist (*hist)[HOP_COUNT]) {
+    struct transport t;
+    struct raid_set rs;
+
+    server_open(&t, &rs, server);
+    server_recv_job(&t, &rs, server_times, hist);
+#ifdef STORAGE_LOG
+    log_compact_start(&rs, server_times);
+#endif
+    server_close(&t, &rs);
+}
+
+/* ===================== DEBUG DUMP ===================== */
+/*
+ * dist/ord buffer 의 debug dump.
+ *   기본        : SM 이 직접 dist_sm_%d.bin / ord_sm_%d.bin 에 기록 (동기)
+ *   -DDUMP_ASYNC: shared ring 에 snapshot 만 복사하고, 별도 dumper process 가
+ *                 DUMP_FILE 하나에 record + 끝에 index 로 모아 쓴다
+ *   -DDUMP_OFF  : dump 하지 않음 (benchmark 용)
+ * 어느 경우든 SM 이 dump_buffer 안에서 보낸 시간을 SM 별로 누적한다.
+ */
+#if defined(DUMP_ASYNC) && defined(DUMP_OFF)
+#error "DUMP_ASYNC and DUMP_OFF are exclusive"
+#endif
+
+enum { DUMP_DIST, DUMP_ORD, DUMP_STOP };
+
+struct dump_rec {
+    int kind;
+    int sm;
+    int offset;     /* 버퍼 안에서의 시작 원소 */
+    int len;
+};
+
+#ifdef DUMP_ASYNC
+#ifndef DUMP_RING_SLOTS
+#define DUMP_RING_SLOTS 64
+#endif
+#define DUMP_SLOT_INTS 4096
+#define DUMP_FILE "dump.bin"
+#define DUMP_MAGIC 0x44554d50   /* "DUMP" */
+
+/* DUMP_FILE 끝: dump_index[count] 뒤에 dump_trailer */
+struct dump_index {
+    struct dump_rec rec;
+    long long file_pos;     /* record 데이터 위치 */
+};
+
+struct dump_trailer {
+    long long index_pos;
+    int count;
+    int magic;
+};
+
+struct dump_slot {
+    struct dump_rec rec;
+    int ready;
+    int data[DUMP_SLOT_INTS];
+};
+#endif
+
+struct dump_shared {
+    double hot[LOGICAL_SM];     /* SM 이 dump 에 쓴 시간 */
+    double dumper_time;         /* dumper 의 파일 기록 시간 */
+    int records;
+#ifdef DUMP_ASYNC
+    unsigned int tail;          /* 다음에 채울 slot 번호 */
+    struct dump_slot slot[DUMP_RING_SLOTS];
+#endif
+};
+
+static struct dump_shared *dump_sh;
+static int dump_shmid;
+#ifdef DUMP_ASYNC
+static int dump_sem_free, dump_sem_full;
+static pid_t dumper_pid;
+#endif
+
+#ifdef DUMP_ASYNC
+static void dump_enqueue(int kind, int sm, int offset, const int *buf, int len) {
+    struct dump_slot *slot;
+
+    sem_wait_s(dump_sem_free);
+    slot = &dump_sh->slot[__atomic_fetch_add(&dump_sh->tail, 1, __ATOMIC_ACQ_REL)
+                          % DUMP_RING_SLOTS];
+    slot->rec.kind = kind;
+    slot->rec.sm = sm;
+    slot->rec.offset = offset;
+    slot->rec.len = len;
+    if (len > 0) memcpy(slot->data, buf, sizeof(int) * len);
+    __atomic_store_n(&slot->ready, 1, __ATOMIC_RELEASE);
+    sem_post_s(dump_sem_full);
+}
+
+/* ring 을 순서대로 비우며 DUMP_FILE 에 기록, DUMP_STOP 을 받으면 index 를 쓰고 종료 */
+static void dumper_run(void) {
+    struct dump_index *index = NULL;
+    struct dump_trailer tr;
+    struct dump_slot *slot;
+    struct timeval s, e;
+    unsigned int head = 0;
+    int cap = 0, count = 0;
+    long long pos = 0;
+    FILE *fp;
+
+    fp = fopen(DUMP_FILE, "wb");
+    if (!fp) { perror("fopen dump"); exit(1); }
+    while (1) {
+        sem_wait_s(dump_sem_full);
+        slot = &dump_sh->slot[head++ % DUMP_RING_SLOTS];
+        while (!__atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE)) usleep(10);
+        if (slot->rec.kind == DUMP_STOP) break;
+
+        gettimeofday(&s, NULL);
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+            index = realloc(index, sizeof(*index) * cap);
+        }
+        fwrite(&slot->rec, sizeof(slot->rec), 1, fp);
+        pos += sizeof(slot->rec);
+        index[count].rec = slot->rec;
+        index[count].file_pos = pos;
+        count++;
+        fwrite(slot->data, sizeof(int), slot->rec.len, fp);
+        pos += sizeof(int) * slot->rec.len;
+        gettimeofday(&e, NULL);
+        dump_sh->dumper_time += GET_DURATION(s, e);
+
+        __atomic_store_n(&slot->ready, 0, __ATOMIC_RELEASE);
+        sem_post_s(dump_sem_free);
+    }
+
+    gettimeofday(&s, NULL);
+    tr.index_pos = pos;
+    tr.count = count;
+    tr.magic = DUMP_MAGIC;
+    fwrite(index, sizeof(*index), count, fp);
+    fwrite(&tr, sizeof(tr), 1, fp);
+    fclose(fp);
+    gettimeofday(&e, NULL);
+    dump_sh->dumper_time += GET_DURATION(s, e);
+    dump_sh->records = count;
+    free(index);
+}
+#elif !defined(DUMP_OFF)
+static void dump_write_file(int kind, int sm, int offset, const int *buf, int len) {
+    char fname[32];
+    int fd;
+
+    sprintf(fname, kind == DUMP_DIST ? "dist_sm_%d.bin" : "ord_sm_%d.bin", sm);
+    fd = open(fname, O_WRONLY | O_CREAT | (offset == 0 ? O_TRUNC : 0), 0644);
+    if (fd < 0) { perror("open dump"); exit(1); }
+    if (pwrite(fd, buf, sizeof(int) * len, (off_t)offset * sizeof(int)) < 0)
+        perror("pwrite dump");
+    close(fd);
+}
+#endif
+
+/* SM sm 의 buffer (시작 원소 offset) 를 dump. fork 전에 dump_init 필요 */
+void dump_buffer(int kind, int sm, int offset, const int *buf, int len) {
+#ifdef DUMP_OFF
+    (void)kind; (void)sm; (void)offset; (void)buf; (void)len;
+#else
+    struct timeval s, e;
+#ifdef DUMP_ASYNC
+    int n;
+#endif
+
+    gettimeofday(&s, NULL);
+#ifdef DUMP_ASYNC
+    for (n = 0; n < len; n += DUMP_SLOT_INTS)
+        dump_enqueue(kind, sm, offset + n, &buf[n],
+                     len - n < DUMP_SLOT_INTS ? len - n : DUMP_SLOT_INTS);
+#else
+    dump_write_file(kind, sm, offset, buf, len);
+    dump_sh->records++;
+#endif
+    gettimeofday(&e, NULL);
+    dump_sh->hot[sm] += GET_DURATION(s, e);
+#endif
+}
+
+/* 통계 segment 와 (async 이면) ring, 세마포어, dumper process 준비 */
+size_t dump_init(void) {
+    dump_shmid = shmget(IPC_PRIVATE, sizeof(struct dump_shared), IPC_CREAT | 0666);
+    dump_sh = shmat(dump_shmid, NULL, 0);
+    memset(dump_sh, 0, sizeof(*dump_sh));
+#ifdef DUMP_ASYNC
+    {
+        union semun arg;
+
+        dump_sem_free = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+        dump_sem_full = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+        arg.val = DUMP_RING_SLOTS;
+        semctl(dump_sem_free, 0, SETVAL, arg);
+        arg.val = 0;
+        semctl(dump_sem_full, 0, SETVAL, arg);
+    }
+    dumper_pid = fork();
+    if (dumper_pid == 0) {
+        dumper_run();
+        exit(0);
+    }
+#endif
+    return sizeof(struct dump_shared);
+}
+
+/* 모든 SM 이 끝난 뒤 호출: dumper 에 종료를 알리고 기다린다 */
+void dump_finish(void) {
+#ifdef DUMP_ASYNC
+    dump_enqueue(DUMP_STOP, 0, 0, NULL, 0);
+    waitpid(dumper_pid, NULL, 0);
+#endif
+}
+
+/* dump 통계 출력 후 자원 해제 */
+void dump_report(void) {
+    double hot_max = 0;
+    int i;
+
+    for (i = 0; i < LOGICAL_SM; i++)
+        if (dump_sh->hot[i] > hot_max) hot_max = dump_sh->hot[i];
+#if defined(DUMP_OFF)
+    printf("[DUMP]          off\n");
+#elif defined(DUMP_ASYNC)
+    printf("[DUMP]          async: SM 당 최대 %.6f sec (snapshot), dumper %.6f sec, %d records -> %s\n",
+           hot_max, dump_sh->dumper_time, dump_sh->records, DUMP_FILE);
+#else
+    printf("[DUMP]          sync: SM 당 최대 %.6f sec (파일 기록), %d writes\n",
+           hot_max, dump_sh->records);
+#endif
+
+    shmdt(dump_sh);
+    shmctl(dump_shmid, IPC_RMID, NULL);
+#ifdef DUMP_ASYNC
+    semctl(dump_sem_free, 0, IPC_RMID);
+    semctl(dump_sem_full, 0, IPC_RMID);
+#endif
+}
+
+/* ===================== DIST FUNCTIONS ===================== */
+/* index 는 word 단위 (원소 하나 = ELEM_WORDS 개 연속 word) */
+void make_dist_4x4(int logical_sm, int *out) {
+    int idx = 0;
+    int tile_col = logical_sm % 4;
+    int tile_row = logical_sm / 4;
+    int tile_w = TILE * ELEM_WORDS;
+    int repeat, base_tile_row, base_row, r, c;
+    
+    for (repeat = 0; repeat < 2; repeat++) {
+        base_tile_row = tile_row + repeat * 2;
+        base_row = base_tile_row * TILE;
+        for (r = base_row; r < base_row + TILE; r++) {
+            for (c = tile_col * tile_w; c < (tile_col + 1) * tile_w; c++) {
+                out[idx++] = r * ROW_WORDS + c;
+            }
+        }
+    }
+}
+
+void make_dist_8x8(int sm, int *out) {
+    int cols_per_sm = STRIP * ELEM_WORDS;
+    int start_col = sm * cols_per_sm;
+    int end_col = start_col + cols_per_sm;
+    int idx = 0;
+    int r, c;
+    
+    for (r = 0; r < N; r++) {
+        for (c = start_col; c < end_col; c++) {
+            out[idx++] = r * ROW_WORDS + c;
+        }
+    }
+}
+
+#if defined(GRID_8x8)
+#define make_dist make_dist_8x8
+#else
+#define make_dist make_dist_4x4
+#endif
+
+/* ===================== LAYOUT ===================== */
+/*
+ * dist 배치를 index 배열 없이 계산한다. SM 의 dist 영역은 길이 LAYOUT_RUN_LEN 인
+ * run 들을 local 순서로 이어 붙인 것이고, run 하나는 행렬에서 연속 구간이다.
+ * (8x8: strip 의 한 줄, 4x4: tile 의 한 줄)
+ */
+#if defined(GRID_8x8)
+#define LAYOUT_RUN_LEN (STRIP * ELEM_WORDS)
+#else
+#define LAYOUT_RUN_LEN (TILE * ELEM_WORDS)
+#endif
+#define LAYOUT_RUNS_PER_SM (LOGICAL_CHUNK / LAYOUT_RUN_LEN)
+
+struct layout_run {
+    int global;     /* 행렬에서의 시작 index (word) */
+    int local;      /* SM dist 영역 안에서의 시작 위치 (word) */
+    int len;        /* word 수 */
+};
+
+struct layout_iter {
+    int sm;
+    int k;          /* 다음 run 번호 */
+};
+
+/* SM sm 의 k 번째 run */
+void layout_run_at(int sm, int k, struct layout_run *run) {
+    run->local = k * LAYOUT_RUN_LEN;
+    run->len = LAYOUT_RUN_LEN;
+#if defined(GRID_8x8)
+    run->global = k * ROW_WORDS + sm * LAYOUT_RUN_LEN;
+#else
+    run->global = ((sm / 4 + (k / TILE) * 2) * TILE + k % TILE) * ROW_WORDS +
+                  (sm % 4) * LAYOUT_RUN_LEN;
+#endif
+}
+
+void layout_begin(struct layout_iter *it, int sm) {
+    it->sm = sm;
+    it->k = 0;
+}
+
+int layout_next(struct layout_iter *it, struct layout_run *run) {
+    if (it->k >= LAYOUT_RUNS_PER_SM) return 0;
+    layout_run_at(it->sm, it->k++, run);
+    return 1;
+}
+
+/*
+ * 일반 layout: 행렬을 bh x bw block 으로 나누고 block (br, bc) 를 SM
+ * (br % pr) * pc + bc % pc 에 준다 (2D block-cyclic). SM 영역은 자기 block 들을
+ * block 행 우선으로, block 안은 row-major 로 이어 붙인 것이다.
+ * 위의 grid 배치도 특수한 경우 (8x8 = LAYOUT_COLS, 4x4 = LAYOUT_TILES).
+ */
+struct dist_layout {
+    const char *name;
+    int bh, bw;         /* block 크기 (행, word) */
+    int pr, pc;         /* SM grid, pr * pc == LOGICAL_SM */
+};
+
+#define LAYOUT_ROWS             { "rows", N / 8, ROW_WORDS, 8, 1 }
+#define LAYOUT_COLS             { "cols", N, ROW_WORDS / 8, 1, 8 }
+#define LAYOUT_TILES            { "tiles", N / 4, ROW_WORDS / 4, 2, 4 }
+#define LAYOUT_ROW_CYCLIC(b)    { "row-cyclic " #b, (b), ROW_WORDS, 8, 1 }
+#define LAYOUT_BLOCK_CYCLIC(b)  { "block-cyclic " #b, (b), (b) * ELEM_WORDS, 2, 4 }
+
+int dlayout_valid(const struct dist_layout *L) {
+    return L->pr * L->pc == LOGICAL_SM && L->bh > 0 && L->bw > 0 &&
+           N % (L->bh * L->pr) == 0 && ROW_WORDS % (L->bw * L->pc) == 0;
+}
+
+/* global word g 의 (SM, 영역 안 위치). 반환값은 g 부터 양쪽 다 연속인 길이 */
+int dlayout_locate(const struct dist_layout *L, int g, int *sm, int *local) {
+    int r = g / ROW_WORDS, c = g % ROW_WORDS;
+    int br = r / L->bh, bc = c / L->bw;
+    int lb = (br / L->pr) * (ROW_WORDS / L->bw / L->pc) + bc / L->pc;
+
+    *sm = (br % L->pr) * L->pc + bc % L->pc;
+    *local = lb * L->bh * L->bw + (r % L->bh) * L->bw + c % L->bw;
+    return L->bw - c % L->bw;
+}
+
+void dlayout_fill(const struct dist_layout *L, int sm, int *dst) {
+    int g, s, local, len, i;
+
+    for (g = 0; g < DATA_SIZE; g += len) {
+        len = dlayout_locate(L, g, &s, &local);
+        if (s == sm)
+            for (i = 0; i < len; i++) dst[local + i] = g + i;
+    }
+}
+
+#ifdef REDIST_PLAN
+static const struct dist_layout redist_src_layout = REDIST_SRC;
+static const struct dist_layout redist_dst_layout = REDIST_DST;
+#endif
+
+/* dist 영역을 layout 에서 바로 채운다 (payload = global index) */
+void layout_fill(int sm, int *dst) {
+#ifdef REDIST_PLAN
+    dlayout_fill(&redist_src_layout, sm, dst);
+#else
+    struct layout_iter it;
+    struct layout_run run;
+    int i;
+
+    layout_begin(&it, sm);
+    while (layout_next(&it, &run))
+        for (i = 0; i < run.len; i++) dst[run.local + i] = run.global + i;
+#endif
+}
+
+/* seg (field 마다 DATA_SIZE) 의 field 전부에 SM sm 의 dist 를 채운다 */
+void layout_fill_fields(int sm, int *seg) {
+    int *dst;
+    int f, i;
+
+    for (f = 0; f < NUM_FIELDS; f++) {
+        dst = &seg[(size_t)f * DATA_SIZE + sm * LOGICAL_CHUNK];
+        layout_fill(sm, dst);
+        for (i = 0; f > 0 && i < LOGICAL_CHUNK; i++) dst[i] += f * DATA_SIZE;
+    }
+}
+
+#ifdef DUMP_LAYOUT
+/* -DDUMP_LAYOUT: index 배열을 make_dist_* 로 만들어 layout 과 대조하고 파일로 저장 */
+void dump_dist(int sm, const int *region) {
+#ifdef REDIST_PLAN
+    /* src layout 이 grid 배치가 아닐 수 있으므로 실제 영역을 그대로 저장 */
+    dump_buffer(DUMP_DIST, sm, 0, region, LOGICAL_CHUNK);
+#else
+    int *dist_buf = malloc(sizeof(int) * LOGICAL_CHUNK);
+
+    make_dist(sm, dist_buf);
+    if (memcmp(dist_buf, region, sizeof(int) * LOGICAL_CHUNK) != 0)
+        fprintf(stderr, "[ERROR] layout mismatch: sm=%d\n", sm);
+    dump_buffer(DUMP_DIST, sm, 0, dist_buf, LOGICAL_CHUNK);
+    free(dist_buf);
+#endif
+}
+#endif
+
+/* ===================== VM EXCHANGE ===================== */
+#ifdef EXCHANGE_VM
+/*
+ * dist 를 staging segment 에 올리지 않는다. SM 은 자기 dist 를 private buffer 에
+ * 만들고 (pid, 주소) 만 공유 table 에 올린다. 목적지 SM 은 source 마다 자기 domain 에
+ * 들어올 run 을 layout 에서 골라 local/remote iovec 으로 묶고 process_vm_readv 한 번에
+ * 가져온다 (연속 run 은 iovec 하나로 합침, UIO_MAXIOV 를 넘으면 나눠 호출).
+ */
+#define VM_IOV_MAX 1024     /* UIO_MAXIOV */
+
+struct vm_peer {
+    pid_t pid;
+    int pad;
+    int *dist;              /* 주소는 그 SM process 안에서만 유효 */
+    long calls, iovs;       /* 목적지 SM 으로서의 통계 */
+    long long bytes;
+};
+
+/* 새 dist buffer 를 layout 에서 채우고 table 에 등록 */
+void vm_publish(struct vm_peer *self, int sm) {
+    int *dist = malloc(sizeof(int) * LOGICAL_CHUNK);
+
+    if (!dist) { perror("malloc(dist)"); exit(1); }
+    layout_fill(sm, dist);
+#ifdef DUMP_LAYOUT
+    dump_dist(sm, dist);
+#endif
+    /* Yama ptrace_scope=1 이면 형제 process 는 기본적으로 못 읽는다 (없으면 EINVAL, 무시) */
+    prctl(PR_SET_PTRACER, PR_SET_PTRACER_ANY, 0, 0, 0);
+    self->pid = getpid();
+    self->dist = dist;
+    self->calls = self->iovs = 0;
+    self->bytes = 0;
+}
+
+static int iov_add(struct iovec *v, int n, void *p, size_t bytes) {
+    if (n > 0 && (char *)v[n - 1].iov_base + v[n - 1].iov_len == (char *)p) {
+        v[n - 1].iov_len += bytes;
+        return n;
+    }
+    v[n].iov_base = p;
+    v[n].iov_len = bytes;
+    return n + 1;
+}
+
+static void vm_read(struct vm_peer *self, pid_t pid, struct iovec *liov, int nl,
+                    struct iovec *riov, int nr, size_t bytes) {
+    long got = syscall(SYS_process_vm_readv, pid, liov, (unsigned long)nl,
+                       riov, (unsigned long)nr, 0UL);
+    if (got != (long)bytes) {
+        perror("process_vm_readv");
+        exit(1);
+    }
+    self->calls++;
+    self->iovs += nl + nr;
+    self->bytes += bytes;
+}
+
+/* 목적지 SM dst 의 domain 을 모든 source 의 private dist 에서 모은다 */
+void vm_gather(struct vm_peer *peers, int dst, int *ord) {
+    struct iovec liov[VM_IOV_MAX], riov[VM_IOV_MAX];
+    struct layout_run run;
+    int s, k, nl, nr;
+    size_t bytes, len;
+    int base = dst * LOGICAL_CHUNK;
+
+    for (s = 0; s < LOGICAL_SM; s++) {
+        nl = nr = 0;
+        bytes = 0;
+        for (k = 0; k < LAYOUT_RUNS_PER_SM; k++) {
+            layout_run_at(s, k, &run);
+            if (run.global / LOGICAL_CHUNK != dst) continue;
+            len = sizeof(int) * run.len;
+            if (s == dst) {     /* 내 dist 는 그냥 복사 */
+                memcpy(&ord[run.global - base], &peers[s].dist[run.local], len);
+                continue;
+            }
+            if (nl == VM_IOV_MAX || nr == VM_IOV_MAX) {
+                vm_read(&peers[dst], peers[s].pid, liov, nl, riov, nr, bytes);
+                nl = nr = 0;
+                bytes = 0;
+            }
+            nl = iov_add(liov, nl, &ord[run.global - base], len);
+            nr = iov_add(riov, nr, &peers[s].dist[run.local], len);
+            bytes += len;
+        }
+        if (nl > 0) vm_read(&peers[dst], peers[s].pid, liov, nl, riov, nr, bytes);
+    }
+}
+#endif
+
+/* ===================== REDISTRIBUTE ===================== */
+/*
+ * 두 dist_layout 사이의 재배치 계획. (source SM, 목적지 SM) 쌍마다 양쪽에서 연속인
+ * run 목록을 목적지 SM 별로 모아 둔다. 한 번 만들면 job 마다 그대로 다시 쓰고,
+ * 실행은 기존 pull 과 같이 shared segment 의 source 영역에서 목적지 buffer 로 복사.
+ */
+struct redist_run {
+    int src_sm;
+    int src_off;        /* source SM 영역 안 위치 */
+    int dst_off;        /* 목적지 SM 영역 안 위치 */
+    int len;
+};
+
+struct redist_plan {
+    struct dist_layout src, dst;
+    struct redist_run *runs;
+    int first[LOGICAL_SM + 1];  /* 목적지 d 의 run 은 runs[first[d] .. first[d + 1]) */
+    int pairs;                  /* run 이 있는 (source, 목적지) 쌍 수 */
+};
+
+static int redist_run_cmp(const void *a, const void *b) {
+    const struct redist_run *x = a, *y = b;
+
+    if (x->src_sm != y->src_sm) return x->src_sm - y->src_sm;
+    return x->dst_off - y->dst_off;
+}
+
+void redist_plan_build(struct redist_plan *p, const struct dist_layout *src,
+                       const struct dist_layout *dst) {
+    int cnt[LOGICAL_SM], pos[LOGICAL_SM];
+    int g, len, ls, ld, ss, sl, ds, dl, d, i, n, start;
+    struct redist_run *r, *out;
+
+    if (!dlayout_valid(src) || !dlayout_valid(dst)) {
+        fprintf(stderr, "redistribute: %s -> %s does not tile N=%d over %d SMs\n",
+                src->name, dst->name, N, LOGICAL_SM);
+        exit(1);
+    }
+    p->src = *src;
+    p->dst = *dst;
+
+    /* pass 1: 목적지별 run 수 (병합 전) */
+    memset(cnt, 0, sizeof(cnt));
+    for (g = 0; g < DATA_SIZE; g += len) {
+        ls = dlayout_locate(src, g, &ss, &sl);
+        ld = dlayout_locate(dst, g, &ds, &dl);
+        len = ls < ld ? ls : ld;
+        cnt[ds]++;
+    }
+    p->first[0] = 0;
+    for (d = 0; d < LOGICAL_SM; d++) {
+        pos[d] = p->first[d];
+        p->first[d + 1] = p->first[d] + cnt[d];
+    }
+    p->runs = malloc(sizeof(struct redist_run) * p->first[LOGICAL_SM]);
+    if (!p->runs) { perror("malloc(plan)"); exit(1); }
+
+    /* pass 2: run 기록 */
+    for (g = 0; g < DATA_SIZE; g += len) {
+        ls = dlayout_locate(src, g, &ss, &sl);
+        ld = dlayout_locate(dst, g, &ds, &dl);
+        len = ls < ld ? ls : ld;
+        r = &p->runs[pos[ds]++];
+        r->src_sm = ss;
+        r->src_off = sl;
+        r->dst_off = dl;
+        r->len = len;
+    }
+
+    /* 목적지마다 source 순으로 정렬, 양쪽 다 이어지는 run 은 합치면서 앞으로 당긴다 */
+    n = 0;
+    p->pairs = 0;
+    for (d = 0; d < LOGICAL_SM; d++) {
+        r = &p->runs[pos[d] - cnt[d]];
+        qsort(r, cnt[d], sizeof(*r), redist_run_cmp);
+        start = n;
+        out = NULL;
+        for (i = 0; i < cnt[d]; i++) {
+            if (out && out->src_sm == r[i].src_sm &&
+                out->src_off + out->len == r[i].src_off &&
+                out->dst_off + out->len == r[i].dst_off) {
+                out->len += r[i].len;
+                continue;
+            }
+            if (!out || out->src_sm != r[i].src_sm) p->pairs++;
+            out = &p->runs[n++];
+            *out = r[i];
+        }
+        p->first[d] = start;
+    }
+    p->first[LOGICAL_SM] = n;
+}
+
+/* 목적지 SM dst_sm 의 영역을 src (SM 영역을 LOGICAL_CHUNK 씩 이어 둔 segment) 에서 채운다 */
+void redistribute(const struct redist_plan *p, const int *src, int dst_sm, int *out) {
+    const struct redist_run *r = &p->runs[p->first[dst_sm]];
+    const struct redist_run *end = &p->runs[p->first[dst_sm + 1]];
+
+    for (; r < end; r++)
+        memcpy(&out[r->dst_off], &src[r->src_sm * LOGICAL_CHUNK + r->src_off],
+               sizeof(int) * r->len);
+}
+
+#if NUM_FIELDS > 1
+/* 같은 계획으로 field K 개를 한 번에: run 하나마다 K 개 field 를 연달아 복사 */
+void redistribute_fields(const struct redist_plan *p, const int *src, int dst_sm, int *out) {
+    const struct redist_run *r = &p->runs[p->first[dst_sm]];
+    const struct redist_run *end = &p->runs[p->first[dst_sm + 1]];
+    int f;
+
+    for (; r < end; r++)
+        for (f = 0; f < NUM_FIELDS; f++)
+            memcpy(&out[(size_t)f * LOGICAL_CHUNK + r->dst_off],
+                   &src[(size_t)f * DATA_SIZE + r->src_sm * LOGICAL_CHUNK + r->src_off],
+                   sizeof(int) * r->len);
+}
+#endif
+
+void redist_plan_free(struct redist_plan *p) {
+    free(p->runs);
+    p->runs = NULL;
+}
+
+#ifdef DUMP_LAYOUT
+/* 목적지 영역을 dst layout 에서 다시 만들어 대조 */
+void redist_verify(const struct redist_plan *p, int sm, const int *region) {
+    int *want = malloc(sizeof(int) * LOGICAL_CHUNK);
+
+    dlayout_fill(&p->dst, sm, want);
+    if (memcmp(want, region, sizeof(int) * LOGICAL_CHUNK) != 0)
+        fprintf(stderr, "[ERROR] redistribute mismatch: sm=%d (%s -> %s)\n",
+                sm, p->src.name, p->dst.name);
+    free(want);
+}
+#endif
+
+/* ===================== REORDER KERNELS ===================== */
+/*
+ * Phase 2 gather: 목적지 row [row_begin, row_end) 를 dst 에 채운다.
+ * SM sm 의 domain 은 row [sm * N/8, (sm + 1) * N/8) 이다.
+ *
+ * DEFINE_REORDER_* 는 N 마다 shape 가 상수인 kernel 을 만든다. 상수 N 이면
+ * / 와 % 는 전부 shift/mask 로 바뀌고, 목적지 row 하나는 source tile(strip)
+ * 별로 연속 구간이므로 원소 단위 계산 없이 구간 memcpy 로 복사한다.
+ * 표에 없는 N 은 원소마다 좌표를 계산하는 generic kernel 로 처리한다.
+ */
+typedef void (*reorder_fn)(const int *src, int *dst, int row_begin, int row_end, int n);
+
+struct reorder_kernel {
+    int n;              /* 0 = 모든 N (generic) */
+    int num_sm;
+    int tile;           /* 4x4: tile 크기, 8x8: strip 폭 */
+    const char *name;
+    reorder_fn fn;
+};
+
+/* 8x8: src 는 SM 별 column strip (폭 N/8). W, CH, RW 는 word 단위 */
+#define DEFINE_REORDER_8x8(NN) \
+static void reorder_8x8_n##NN(const int *src, int *dst, int row_begin, int row_end, int n) \
+{ \
+    const int RW = (NN) * ELEM_WORDS; \
+    const int W = RW / 8; \
+    const int CH = (NN) * RW / 8; \
+    int r, o; \
+    (void)n; \
+    for (r = row_begin; r < row_end; r++) \
+        for (o = 0; o < 8; o++) \
+            memcpy(&dst[(r - row_begin) * RW + o * W], \
+                   &src[o * CH + r * W], sizeof(int) * W); \
+}
+
+/* 4x4: src 는 logical SM 별 (T 행 x TW word tile) x 2 */
+#define DEFINE_REORDER_4x4(NN) \
+static void reorder_4x4_n##NN(const int *src, int *dst, int row_begin, int row_end, int n) \
+{ \
+    const int RW = (NN) * ELEM_WORDS; \
+    const int T = (NN) / 4; \
+    const int TW = RW / 4; \
+    const int CH = (NN) * RW / 8; \
+    int r, tc, tile_row, base; \
+    (void)n; \
+    for (r = row_begin; r < row_end; r++) { \
+        tile_row = r / T; \
+        base = (tile_row % 2) * 4 * CH + (tile_row / 2) * T * TW + (r % T) * TW; \
+        for (tc = 0; tc < 4; tc++) \
+            memcpy(&dst[(r - row_begin) * RW + tc * TW], \
+                   &src[base + tc * CH], sizeof(int) * TW); \
+    } \
+}
+
+#define REORDER_ENTRY(GRID, NN, T) \
+    { NN, NUM_SM, T, "reorder_" #GRID "_n" #NN, reorder_##GRID##_n##NN }
+
+/*
+ * generic kernel 의 원소 하나 복사. 4/8/16 byte 는 load/store 한 번,
+ * 그 외 크기는 memcpy. 좌표 계산은 원소 단위, 주소는 word 단위.
+ */
+#if ELEM_SIZE == 4
+#define COPY_ELEM(d, s) (*(d) = *(s))
+#elif ELEM_SIZE == 8
+#define COPY_ELEM(d, s) memcpy(d, s, 8)     /* int64_t lvalue 는 aliasing 위반, memcpy 도 mov 한 번 */
+#elif ELEM_SIZE == 16 && defined(__SSE2__)
+#define COPY_ELEM(d, s) \
+    _mm_storeu_si128((__m128i *)(d), _mm_loadu_si128((const __m128i *)(s)))
+#else
+#define COPY_ELEM(d, s) memcpy(d, s, ELEM_SIZE)
+#endif
+
+#if defined(GRID_8x8)
+static void reorder_8x8_generic(const int *src, int *dst, int row_begin, int row_end, int n) {
+    int w = n / 8;
+    int ch = n * n / 8;
+    int start = row_begin * n;
+    int j, global, row, col, owner_sm, owner_pos;
+
+    for (j = 0; j < (row_end - row_begin) * n; j++) {
+        global = start + j;
+        row = global / n;
+        col = global % n;
+        owner_sm = col / w;
+        owner_pos = row * w + (col % w);
+        COPY_ELEM(&dst[j * ELEM_WORDS], &src[(owner_sm * ch + owner_pos) * ELEM_WORDS]);
+    }
+}
+
+DEFINE_REORDER_8x8(64)
+DEFINE_REORDER_8x8(128)
+DEFINE_REORDER_8x8(256)
+DEFINE_REORDER_8x8(512)
+DEFINE_REORDER_8x8(1024)
+DEFINE_REORDER_8x8(2048)
+DEFINE_REORDER_8x8(4096)
+DEFINE_REORDER_8x8(8192)
+
+static const struct reorder_kernel reorder_kernels[] = {
+    REORDER_ENTRY(8x8, 64, 8),
+    REORDER_ENTRY(8x8, 128, 16),
+    REORDER_ENTRY(8x8, 256, 32),
+    REORDER_ENTRY(8x8, 512, 64),
+    REORDER_ENTRY(8x8, 1024, 128),
+    REORDER_ENTRY(8x8, 2048, 256),
+    REORDER_ENTRY(8x8, 4096, 512),
+    REORDER_ENTRY(8x8, 8192, 1024),
+    { 0, NUM_SM, 0, "reorder_8x8_generic", reorder_8x8_generic }
+};
+#elif defined(GRID_4x4)
+static void reorder_4x4_generic(const int *src, int *dst, int row_begin, int row_end, int n) {
+    int t = n / 4;
+    int ch = n * n / 8;
+    int j, target_global, row, col, tile_row, tile_col, src_sm, src_pos;
+
+    for (j = 0; j < (row_end - row_begin) * n; j++) {
+        target_global = row_begin * n + j;
+        row = target_global / n;
+        col = target_global % n;
+        tile_row = row / t;
+        tile_col = col / t;
+        src_sm = (tile_row % 2) * 4 + tile_col;
+        src_pos = (tile_row / 2) * t * t + (row % t) * t + (col % t);
+        COPY_ELEM(&dst[j * ELEM_WORDS], &src[(src_sm * ch + src_pos) * ELEM_WORDS]);
+    }
+}
+
+DEFINE_REORDER_4x4(64)
+DEFINE_REORDER_4x4(128)
+DEFINE_REORDER_4x4(256)
+DEFINE_REORDER_4x4(512)
+DEFINE_REORDER_4x4(1024)
+DEFINE_REORDER_4x4(2048)
+DEFINE_REORDER_4x4(4096)
+DEFINE_REORDER_4x4(8192)
+
+static const struct reorder_kernel reorder_kernels[] = {
+    REORDER_ENTRY(4x4, 64, 16),
+    REORDER_ENTRY(4x4, 128, 32),
+    REORDER_ENTRY(4x4, 256, 64),
+    REORDER_ENTRY(4x4, 512, 128),
+    REORDER_ENTRY(4x4, 1024, 256),
+    REORDER_ENTRY(4x4, 2048, 512),
+    REORDER_ENTRY(4x4, 4096, 1024),
+    REORDER_ENTRY(4x4, 8192, 2048),
+    { 0, NUM_SM, 0, "reorder_4x4_generic", reorder_4x4_generic }
+};
+#endif
+
+#ifdef REDIST_PLAN
+/* main 이 fork 전에 만든 계획 (worker 는 fork 로 물려받는다) */
+static struct redist_plan redist_active;
+
+static void reorder_plan(const int *src, int *dst, int row_begin, int row_end, int n) {
+    int sm = row_begin / (N / 8);
+
+    (void)row_end;
+    (void)n;
+    redistribute(&redist_active, src, sm, dst);
+#ifdef DUMP_LAYOUT
+    redist_verify(&redist_active, sm, dst);
+#endif
+}
+
+static const struct reorder_kernel plan_kernel = {
+    0, NUM_SM, 0, "redistribute (plan)", reorder_plan
+};
+#endif
+
+/*
+ * batch 재배치: src 는 field 마다 DATA_SIZE, dst 는 목적지 domain 크기씩 field 순.
+ * 고정 kernel 은 FIELD_ROWS 줄마다 field 를 바꿔 돌리고, 계획은 run 단위로 K 개를 묶는다.
+ */
+void reorder_fields(const struct reorder_kernel *k, const int *src, int *dst,
+                    int row_begin, int row_end) {
+#if NUM_FIELDS == 1
+    k->fn(src, dst, row_begin, row_end, N);
+#elif defined(REDIST_PLAN)
+    (void)k;
+    (void)row_end;
+    redistribute_fields(&redist_active, src, row_begin / (N / 8), dst);
+#ifdef DUMP_LAYOUT
+    redist_verify(&redist_active, row_begin / (N / 8), dst);     /* field 0 */
+#endif
+#else
+    size_t dom = (size_t)(row_end - row_begin) * ROW_WORDS;
+    int r, re, f;
+
+    for (r = row_begin; r < row_end; r = re) {
+        re = r + FIELD_ROWS < row_end ? r + FIELD_ROWS : row_end;
+        for (f = 0; f < NUM_FIELDS; f++)
+            k->fn(&src[(size_t)f * DATA_SIZE],
+                  &dst[f * dom + (size_t)(r - row_begin) * ROW_WORDS], r, re, N);
+    }
+#endif
+}
+
+#define NUM_REORDER_KERNELS \
+    ((int)(sizeof(reorder_kernels) / sizeof(reorder_kernels[0])))
+
+/* -DREORDER_GENERIC 이면 비교용으로 항상 generic kernel 사용 */
+const struct reorder_kernel *select_reorder_kernel(int n) {
+    int k;
+
+#if defined(REDIST_PLAN)
+    (void)n;
+    (void)k;
+    return &plan_kernel;
+#elif defined(REORDER_GENERIC)
+    (void)n;
+#else
+    for (k = 0; k < NUM_REORDER_KERNELS - 1; k++) {
+        if (reorder_kernels[k].n == n && reorder_kernels[k].num_sm == NUM_SM)
+            return &reorder_kernels[k];
+    }
+#endif
+    k = NUM_REORDER_KERNELS - 1;
+    return &reorder_kernels[k];
+}
+
+/* ===================== IN-PLACE REDISTRIBUTION ===================== */
+#ifdef REDIST_INPLACE
+/*
+ * -DREDIST_INPLACE: ord buffer 없이 dist segment 하나 안에서 재배치한다.
+ * dist 위치 p 의 원소는 global index 위치로 가야 하므로, 이 순열의 cycle 을
+ * 따라가며 원소를 하나씩 밀어 넣는다. cycle 은 서로 겹치지 않으므로
+ * 각 SM 이 자기 몫의 cycle leader 만 처리하면 lock 이 필요 없다.
+ */
+struct cycle_plan {
+    int num_cycles;
+    int *leader;                /* SM 순서로 나열된 cycle leader */
+    int first[LOGICAL_SM + 1];  /* SM s 의 leader: leader[first[s] .. first[s+1]) */
+    long moved[LOGICAL_SM];     /* SM 별 이동 원소 수 */
+};
+
+/* dist 배치의 위치 p 에 있는 원소의 global index (= 재배치 후 위치) */
+static int dist_to_global(int p) {
+    int q = p % LOGICAL_CHUNK;
+    struct layout_run run;
+
+    layout_run_at(p / LOGICAL_CHUNK, q / LAYOUT_RUN_LEN, &run);
+    return run.global + q % LAYOUT_RUN_LEN;
+}
+
+/* 길이 2 이상인 cycle 의 leader(최소 위치)를 찾아 이동량 기준으로 SM 에 나눈다 */
+void build_cycle_plan(struct cycle_plan *plan) {
+    unsigned char *visited = calloc(DATA_SIZE / 8 + 1, 1);
+    int *len = NULL;
+    int cap = 0;
+    long total = 0, acc = 0;
+    int p, q, c, s, l;
+
+    plan->num_cycles = 0;
+    plan->leader = NULL;
+    for (p = 0; p < DATA_SIZE; p++) {
+        if (visited[p >> 3] & (1 << (p & 7))) continue;
+        l = 0;
+        q = p;
+        do {
+            visited[q >> 3] |= 1 << (q & 7);
+            q = dist_to_global(q);
+            l++;
+        } while (q != p);
+        if (l < 2) continue;
+
+        if (plan->num_cycles == cap) {
+            cap = cap ? cap * 2 : 1024;
+            plan->leader = realloc(plan->leader, sizeof(int) * cap);
+            len = realloc(len, sizeof(int) * cap);
+        }
+        plan->leader[plan->num_cycles] = p;
+        len[plan->num_cycles] = l;
+        plan->num_cycles++;
+        total += l;
+    }
+
+    /* leader 순서대로 누적 이동량이 균등해지도록 자른다 */
+    for (s = 0; s < LOGICAL_SM; s++) plan->moved[s] = 0;
+    plan->first[0] = 0;
+    s = 0;
+    for (c = 0; c < plan->num_cycles; c++) {
+        while (s < LOGICAL_SM - 1 && acc >= total * (s + 1) / LOGICAL_SM)
+            plan->first[++s] = c;
+        plan->moved[s] += len[c];
+        acc += len[c];
+    }
+    while (s < LOGICAL_SM) plan->first[++s] = plan->num_cycles;
+
+    free(len);
+    free(visited);
+}
+
+/* SM sm 에 배정된 cycle 을 a 위에서 제자리 회전 */
+void run_cycles(int *a, const struct cycle_plan *plan, int sm) {
+    int c, p, dst, val, tmp;
+
+    for (c = plan->first[sm]; c < plan->first[sm + 1]; c++) {
+        p = plan->leader[c];
+        val = a[p];
+        do {
+            dst = dist_to_global(p);
+            tmp = a[dst];
+            a[dst] = val;
+            val = tmp;
+            p = dst;
+        } while (p != plan->leader[c]);
+    }
+}
+#endif
+
+/* ===================== OUT-OF-CORE ===================== */
+#ifdef OUT_OF_CORE
+/*
+ * 행렬 전체를 메모리에 올리지 않고 dist_sm_%d.bin 에서 BAND_ROWS 줄씩 읽는다.
+ * window segment 는 band 2 개 (double buffering) 크기이고, 각 SM 은 자기
+ * dist 파일에서 band 에 해당하는 구간을 읽어 window 의 목적지 위치에 쓴다.
+ * band 를 소유한 domain 의 SM 이 다 채워진 band 를 바로 server 로 보낸다.
+ */
+
+/* SM sm 이 row r0 부터의 band 에 가진 데이터: 파일 offset, 목적지 열, 폭 */
+static int band_part(int sm, int r0, long *file_off, int *dst_col, int *width) {
+#if defined(GRID_8x8)
+    *width = STRIP;
+    *dst_col = sm * STRIP;
+    *file_off = (long)r0 * STRIP;
+    return 1;
+#else
+    int tile_row = r0 / TILE;
+
+    if (sm / 4 != tile_row % 2) return 0;
+    *width = TILE;
+    *dst_col = (sm % 4) * TILE;
+    *file_off = (long)(tile_row / 2) * TILE * TILE + (long)(r0 % TILE) * TILE;
+    return 1;
+#endif
+}
+
+/* layout 의 run 단위로 dist 파일 생성 (메모리 사용 O(N)) */
+void write_dist_file(int sm) {
+    int row[LAYOUT_RUN_LEN];
+    char fname[32];
+    FILE *fp;
+    struct layout_iter it;
+    struct layout_run run;
+    int c;
+
+    sprintf(fname, "dist_sm_%d.bin", sm);
+    fp = fopen(fname, "wb");
+    if (!fp) { perror("fopen dist"); exit(1); }
+    layout_begin(&it, sm);
+    while (layout_next(&it, &run)) {
+        for (c = 0; c < run.len; c++) row[c] = run.global + c;
+        fwrite(row, sizeof(int), run.len, fp);
+    }
+    fclose(fp);
+}
+
+/*
+ * SM sm 의 band loop.
+ * sem_free[slot * LOGICAL_SM + sm]: 이 SM 이 slot 에 써도 되는지 (초기 1)
+ * sem_full[slot]: slot 을 채운 SM 수
+ */
+void ooc_run_sm(int sm, int *window, int sem_free, int sem_full) {
+    int *buf = malloc(sizeof(int) * BAND_ROWS * N / 4);
+    char fname[32];
+    struct chan ch;
+    int fd;
+    int b, slot, r0, r, s, c, dst_col, width;
+    long file_off;
+    int *band;
+
+    sprintf(fname, "dist_sm_%d.bin", sm);
+    fd = open(fname, O_RDONLY);
+    if (fd < 0) { perror("open dist"); exit(1); }
+    chan_open(&ch);
+
+    for (b = 0; b < NUM_BANDS; b++) {
+        slot = b % 2;
+        r0 = b * BAND_ROWS;
+        band = &window[slot * BAND_SIZE];
+
+        sem_op_n(sem_free, slot * LOGICAL_SM + sm, -1);
+        if (band_part(sm, r0, &file_off, &dst_col, &width)) {
+            if (pread(fd, buf, sizeof(int) * BAND_ROWS * width,
+                      (off_t)file_off * sizeof(int)) != (ssize_t)(sizeof(int) * BAND_ROWS * width)) {
+                perror("pread dist"); exit(1);
+            }
+            for (r = 0; r < BAND_ROWS; r++)
+                memcpy(&band[r * N + dst_col], &buf[r * width], sizeof(int) * width);
+        }
+        sem_op_n(sem_full, slot, 1);
+
+        /* 내 domain 의 band 이면 모두 채워질 때까지 기다렸다가 전송 */
+        if (r0 / (N / 8) == sm) {
+            sem_op_n(sem_full, slot, -LOGICAL_SM);
+            dump_buffer(DUMP_ORD, sm, (r0 % (N / 8)) * N, band, BAND_SIZE);
+            for (c = 0; c < BAND_SIZE / CHUNK_INT; c++)
+                send_chunk(&ch, sm, (r0 % (N / 8)) * N / CHUNK_INT + c,
+                           &band[c * CHUNK_INT]);
+            chan_flush(&ch);
+            for (s = 0; s < LOGICAL_SM; s++)
+                sem_op_n(sem_free, slot * LOGICAL_SM + s, 1);
+        }
+    }
+
+    close(fd);
+    chan_close(&ch);
+    free(buf);
+}
+#endif
+
+/* ===================== WORK STEALING ===================== */
+#ifdef WORK_STEALING
+/*
+ * SM 마다 자기 domain 의 tile (STEAL_ROWS 줄) 범위 [top, bottom) 를 deque 로 둔다.
+ * 주인은 bottom 쪽에서 꺼내고, 일이 떨어진 SM 은 다른 SM 의 top 쪽에서 훔친다.
+ * (top << 32) | bottom 을 64bit CAS 로 바꾸므로 lock 이 없고, 결과는 공유 ord
+ * segment 의 원래 domain 위치에 쓰므로 전송 단계의 소유권은 그대로다.
+ */
+struct ws_deque {
+    unsigned long long range;       /* (top << 32) | bottom */
+    char pad[64 - sizeof(unsigned long long)];
+};
+
+struct ws_shared {
+    struct ws_deque deque[LOGICAL_SM];
+    long tiles[LOGICAL_SM];         /* 처리한 tile 수 */
+    long steals[LOGICAL_SM];        /* 다른 SM 에서 훔친 tile 수 */
+    double busy[LOGICAL_SM];        /* kernel 실행 시간 */
+};
+
+void ws_init(struct ws_shared *ws) {
+    int s;
+
+    memset(ws, 0, sizeof(*ws));
+    for (s = 0; s < LOGICAL_SM; s++)
+        ws->deque[s].range = TILES_PER_SM;
+}
+
+/* from_top 이면 top 을, 아니면 bottom 을 한 칸 줄여 tile 번호를 돌려준다 (없으면 -1) */
+static int ws_take(struct ws_deque *dq, int from_top) {
+    unsigned long long old, upd;
+    unsigned int top, bottom;
+    int tile;
+
+    old = __atomic_load_n(&dq->range, __ATOMIC_ACQUIRE);
+    do {
+        top = (unsigned int)(old >> 32);
+        bottom = (unsigned int)old;
+        if (top >= bottom) return -1;
+        if (from_top) {
+            tile = top;
+            upd = ((unsigned long long)(top + 1) << 32) | bottom;
+        } else {
+            tile = bottom - 1;
+            upd = ((unsigned long long)top << 32) | (bottom - 1);
+        }
+    } while (!__atomic_compare_exchange_n(&dq->range, &old, upd, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return tile;
+}
+
+void ws_run(int sm, const int *src, int *ord, struct ws_shared *ws,
+            const struct reorder_kernel *kernel) {
+    struct timeval s, e;
+    int owner, tile, v, r0;
+
+    while (1) {
+        owner = sm;
+        tile = ws_take(&ws->deque[sm], 0);
+        for (v = 1; tile < 0 && v < LOGICAL_SM; v++) {
+            owner = (sm + v) % LOGICAL_SM;
+            tile = ws_take(&ws->deque[owner], 1);
+        }
+        if (tile < 0) break;    /* deque 는 줄어들기만 하므로 모두 비었음 */
+        if (owner != sm) ws->steals[sm]++;
+
+#ifdef STRAGGLER_US
+        if (sm == 0) usleep(STRAGGLER_US / TILES_PER_SM);
+#endif
+        r0 = owner * (N / 8) + tile * STEAL_ROWS;
+        gettimeofday(&s, NULL);
+        kernel->fn(src, &ord[r0 * N], r0, r0 + STEAL_ROWS, N);
+        gettimeofday(&e, NULL);
+        ws->busy[sm] += GET_DURATION(s, e);
+        ws->tiles[sm]++;
+    }
+}
+#endif
+
+/* ===================== PUSH MODE ===================== */
+#ifdef PUSH_MODE
+/*
+ * pull 방식은 목적지 SM 이 여러 SM 의 dist 영역에서 모아 오지만, push 방식은
+ * source SM 이 자기 dist 를 한 번 순서대로 읽어 목적지 위치로 run 단위로 쓴다.
+ * 긴 run 은 non-temporal store 로 써서 목적지 cache line 을 읽어 오지 않는다.
+ * NT store 는 순서 보장이 약하므로 끝에 sfence 후 barrier 에 들어간다.
+ */
+#if defined(__AVX__)
+#define PUSH_NT_NAME "avx stream"
+#elif defined(__SSE2__)
+#define PUSH_NT_NAME "sse2 stream"
+#else
+#define PUSH_NT_NAME "memcpy"
+#endif
+
+static void push_copy(int *dst, const int *src, int len) {
+    int i = 0;
+
+#if defined(__AVX__)
+    if (len >= NT_MIN_INTS && ((uintptr_t)dst & 31) == 0) {
+        for (; i + 8 <= len; i += 8)
+            _mm256_stream_si256((__m256i *)&dst[i],
+                                _mm256_loadu_si256((const __m256i *)&src[i]));
+    }
+#elif defined(__SSE2__)
+    if (len >= NT_MIN_INTS && ((uintptr_t)dst & 15) == 0) {
+        for (; i + 4 <= len; i += 4)
+            _mm_stream_si128((__m128i *)&dst[i],
+                             _mm_loadu_si128((const __m128i *)&src[i]));
+    }
+#endif
+    if (i < len) memcpy(&dst[i], &src[i], sizeof(int) * (len - i));
+}
+
+/* SM sm 의 dist (src, LOGICAL_CHUNK 개) 를 global 순서의 ord 에 scatter */
+void push_scatter(int sm, const int *src, int *ord) {
+    struct layout_iter it;
+    struct layout_run run;
+
+    layout_begin(&it, sm);
+    while (layout_next(&it, &run))
+        push_copy(&ord[run.global], &src[run.local], run.len);
+#if defined(__SSE2__)
+    _mm_sfence();
+#endif
+}
+#endif
+
+/* ===================== DAEMON ===================== */
+#ifdef DAEMON_MODE
+/*
+ * 상주 모드: server 와 LOGICAL_SM 개 worker 는 처음에 한 번만 fork 되고,
+ * control queue (CTRL_KEY) 로 들어오는 job 마다 재정렬 + 전송만 반복한다.
+ * counters[3] 이 1 이면 worker 는 다음 GO 에서 종료한다.
+ */
+/* control queue 도 MSG_KEY 에서 유도해 -DMSG_KEY 로 나눈 실행끼리 job 을 가로채지 않게 */
+#ifndef CTRL_KEY
+#define CTRL_KEY (MSG_KEY + 1)
+#endif
+#if CTRL_KEY >= MSG_KEY && CTRL_KEY < MSG_KEY + 0x10 * NUM_SERVERS && (CTRL_KEY - MSG_KEY) % 0x10 == 0
+#error "CTRL_KEY collides with a server queue key (MSG_KEY + 0x10 * s)"
+#endif
+#define CTRL_JOB      1   /* 요청: job 실행 */
+#define CTRL_SHUTDOWN 2   /* 요청: daemon 종료 */
+#define CTRL_REPLY    3   /* 응답: job 완료 */
+
+struct ctrlbuf {
+    long mtype;
+    int job_id;
+};
+
+#ifdef INCREMENTAL
+/* frame 간 dirty tile bitmap (global tile 번호 tr * DIRTY_COLS + tc) 과 이동량 통계 */
+struct incr_shared {
+    unsigned long long bits[(DIRTY_TILES + 63) / 64];
+    int full;                       /* 1 이면 tile 대신 kernel 로 전체 재정렬 */
+    long long gathered, sent;       /* 이번 frame 재정렬 / 전송 byte */
+    long long first_gathered, first_sent;
+    long long sum_gathered, sum_sent, sum_tiles;
+    int tiles;                      /* 이번 frame dirty tile 수 */
+};
+#endif
+
+struct daemon_ipc {
+    int *shared;
+    int *counters;
+    int sem_ready, sem_go_cc, sem_done_cc, sem_go_cs, sem_done_cs;
+    int sem_job;        /* server 마다 job 하나를 다 쓰면 post */
+#ifdef INCREMENTAL
+    struct incr_shared *incr;
+#endif
+};
+
+/* 상주 server: job 마다 RAID 파일을 처음부터 다시 쓴다 */
+void server_daemon(int server, double *server_times,
+                   struct lat_hist (*hist)[HOP_COUNT], int sem_job) {
+    struct transport t;
+    struct raid_set rs;
+
+    server_open(&t, &rs, server);
+    while (1) {
+        raid_rewind(&rs);
+        if (server_recv_job(&t, &rs, server_times, hist) < 0) break;
+        sem_post_s(sem_job);
+#ifdef STORAGE_LOG
+        /* job 완료를 알린 뒤 compaction 은 다음 job 과 겹쳐 돈다 */
+        log_compact_start(&rs, server_times);
+#endif
+    }
+    server_close(&t, &rs);
+}
+
+#ifdef INCREMENTAL
+/* global (r, c) 의 source dist 위치 (grid 배치, generic kernel 과 같은 식) */
+static int incr_src(int r, int c) {
+#if defined(GRID_8x8)
+    return (c / STRIP) * LOGICAL_CHUNK + r * STRIP + c % STRIP;
+#else
+    int tr = r / TILE, tc = c / TILE;
+
+    return ((tr % 2) * 4 + tc) * LOGICAL_CHUNK + (tr / 2) * TILE * TILE +
+           (r % TILE) * TILE + c % TILE;
+#endif
+}
+
+/* 응용 쪽 write API: tile (tr, tc) 를 frame 값으로 다시 쓰고 dirty 표시 */
+void incr_write_tile(int *dist, struct incr_shared *is, int tr, int tc, int frame) {
+    int t = tr * DIRTY_COLS + tc;
+    int r, c, *p;
+
+    for (r = tr * DIRTY_TILE; r < (tr + 1) * DIRTY_TILE; r++) {
+        p = &dist[incr_src(r, tc * DIRTY_TILE)];    /* tile 한 줄은 source 에서도 연속 */
+        for (c = 0; c < DIRTY_TILE; c++)
+            p[c] = r * N + tc * DIRTY_TILE + c + frame * DATA_SIZE;
+    }
+    is->bits[t / 64] |= 1ULL << (t % 64);
+}
+
+/* frame 입력 생성: frame 0 은 Phase 1 의 dist 그대로 전체, 이후 DIRTY_PCT % tile 갱신 */
+void incr_next_frame(int *dist, struct incr_shared *is, int *tile_frame, int frame) {
+    static unsigned int seed = 12345;
+    int k, t;
+
+    if (frame == 0) {
+        memset(is->bits, 0xff, sizeof(is->bits));
+        is->full = 1;
+        return;
+    }
+    for (k = 0; k < DIRTY_TILES * DIRTY_PCT / 100; k++) {
+        seed = seed * 1103515245 + 12345;
+        t = (seed >> 8) % DIRTY_TILES;
+        incr_write_tile(dist, is, t / DIRTY_COLS, t % DIRTY_COLS, frame);
+        tile_frame[t] = frame;
+    }
+}
+
+/* frame 통계를 누적하고 bitmap 을 비운다 */
+void incr_end_frame(struct incr_shared *is, int frame) {
+    if (frame == 0) {
+        is->first_gathered = is->gathered;
+        is->first_sent = is->sent;
+    } else {
+        is->sum_gathered += is->gathered;
+        is->sum_sent += is->sent;
+        is->sum_tiles += is->tiles;
+    }
+    memset(is->bits, 0, sizeof(is->bits));
+    is->full = 0;
+    is->gathered = is->sent = 0;
+    is->tiles = 0;
+}
+
+/*
+ * 목적지 sm 의 domain 중 dirty tile 만 source dist 에서 다시 모은다.
+ * 바뀐 segment 의 domain offset 을 segs 에 담아 개수를 돌려주고, 전체 재정렬이면 -1.
+ */
+static int incr_gather(int sm, const struct daemon_ipc *ipc,
+                       const struct reorder_kernel *kernel, int *ord, int *segs) {
+    struct incr_shared *is = ipc->incr;
+    int r0 = sm * (N / 8);
+    int tr, tc, t, r, off, tiles = 0, nseg = 0;
+
+    if (is->full) {
+        kernel->fn(ipc->shared, ord, r0, r0 + N / 8, N);
+        __atomic_fetch_add(&is->gathered, (long long)sizeof(int) * LOGICAL_CHUNK,
+                           __ATOMIC_RELAXED);
+        return -1;
+    }
+    for (tr = r0 / DIRTY_TILE; tr < (r0 + N / 8) / DIRTY_TILE; tr++) {
+        for (tc = 0; tc < DIRTY_COLS; tc++) {
+            t = tr * DIRTY_COLS + tc;
+            if (!((is->bits[t / 64] >> (t % 64)) & 1)) continue;
+            for (r = tr * DIRTY_TILE; r < (tr + 1) * DIRTY_TILE; r++) {
+                off = (r - r0) * N + tc * DIRTY_TILE;
+                memcpy(&ord[off], &ipc->shared[incr_src(r, tc * DIRTY_TILE)],
+                       sizeof(int) * DIRTY_TILE);
+                segs[nseg++] = off;
+            }
+            tiles++;
+        }
+    }
+    __atomic_fetch_add(&is->gathered, (long long)tiles * DIRTY_TILE * DIRTY_TILE * sizeof(int),
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&is->tiles, tiles, __ATOMIC_RELAXED);
+    return nseg;
+}
+
+/*
+ * 전체 frame 이면 chunk 전부, 아니면 바뀐 segment 를 SEGS_PER_MSG 개씩 묶어 보낸다.
+ * segment message: data[0 .. k) 는 domain offset, data[SEGS_PER_MSG ..] 부터 payload.
+ * 끝에 frame 끝 표시.
+ */
+static void incr_send(struct chan *ch, int sm, struct incr_shared *is, const int *ord,
+                      const int *segs, int nseg) {
+    struct msgbuf msg;
+    int c, k, n, sent = 0;
+
+    for (c = 0; nseg < 0 && c < MSGS_PER_SM; c++, sent++)
+        send_chunk(ch, sm, c, &ord[c * CHUNK_INT]);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.mtype = sm + 1;
+    msg.hdr.sm = sm;
+    msg.hdr.chunk = FRAME_SEGS;
+    for (k = 0; k < nseg; k += n, sent++) {
+        n = nseg - k < SEGS_PER_MSG ? nseg - k : SEGS_PER_MSG;
+        for (c = 0; c < n; c++) {
+            msg.data[c] = segs[k + c];
+            memcpy(&msg.data[SEGS_PER_MSG + c * DIRTY_TILE], &ord[segs[k + c]],
+                   sizeof(int) * DIRTY_TILE);
+        }
+        msg.hdr.pad = n;
+        msg.hdr.send_ns = now_ns();
+        chan_send(ch, &msg);
+    }
+
+    msg.hdr.chunk = FRAME_END;
+    msg.hdr.pad = 0;
+    msg.hdr.send_ns = now_ns();
+    chan_send(ch, &msg);
+    __atomic_fetch_add(&is->sent, (long long)sent * CHUNK_INT * sizeof(int), __ATOMIC_RELAXED);
+}
+
+/* 마지막 frame 뒤 RAID 내용을 tile 별 마지막 frame 값과 대조 */
+long incr_verify(const int *tile_frame) {
+    int *buf = malloc(sizeof(int) * 2 * LOGICAL_CHUNK);
+    char fn[32];
+    FILE *fp;
+    long bad = 0;
+    int disk, sm, j, g;
+
+    for (disk = 0; disk < 4; disk++) {
+        sprintf(fn, "raid_disk%d.bin", disk);
+        fp = fopen(fn, "rb");
+        if (!fp || fread(buf, sizeof(int), 2 * LOGICAL_CHUNK, fp) != 2 * LOGICAL_CHUNK) {
+            perror("read raid_disk"); exit(1);
+        }
+        fclose(fp);
+        for (j = 0; j < 2 * LOGICAL_CHUNK; j++) {
+            sm = disk + 4 * (j / LOGICAL_CHUNK);
+            g = sm * LOGICAL_CHUNK + j % LOGICAL_CHUNK;
+            if (buf[j] != g + tile_frame[(g / N / DIRTY_TILE) * DIRTY_COLS +
+                                         g % N / DIRTY_TILE] * DATA_SIZE)
+                bad++;
+        }
+    }
+    free(buf);
+    return bad;
+}
+#endif
+
+void daemon_worker(int sm, const struct daemon_ipc *ipc,
+                   const struct reorder_kernel *kernel) {
+    int *ord_buf = malloc(sizeof(int) * LOGICAL_CHUNK);
+    struct chan ch;
+    int c;
+#ifdef INCREMENTAL
+    int *segs = malloc(sizeof(int) * (LOGICAL_CHUNK / DIRTY_TILE));
+    int nseg;
+#endif
+
+    chan_open(&ch);
+
+    sem_wait_s(ipc->sem_ready);
+    ipc->counters[0]++;
+    sem_post_s(ipc->sem_ready);
+
+    while (1) {
+        sem_wait_s(ipc->sem_go_cc);
+        if (ipc->counters[3]) break;
+
+#ifdef INCREMENTAL
+        /* ord_buf 는 frame 사이에 유지: 바뀐 tile 만 덮어쓴다 */
+        nseg = incr_gather(sm, ipc, kernel, ord_buf, segs);
+#else
+        kernel->fn(ipc->shared, ord_buf, sm * (N / 8), (sm + 1) * (N / 8), N);
+#endif
+
+        dump_buffer(DUMP_ORD, sm, 0, ord_buf, LOGICAL_CHUNK);
+
+        sem_wait_s(ipc->sem_done_cc);
+        ipc->counters[1]++;
+        sem_post_s(ipc->sem_done_cc);
+
+        sem_wait_s(ipc->sem_go_cs);
+#ifdef INCREMENTAL
+        incr_send(&ch, sm, ipc->incr, ord_buf, segs, nseg);
+        (void)c;
+#else
+        for (c = 0; c < MSGS_PER_SM; c++)
+            send_chunk(&ch, sm, c, &ord_buf[c * CHUNK_INT]);
+#endif
+        chan_flush(&ch);
+
+        sem_wait_s(ipc->sem_done_cs);
+        ipc->counters[2]++;
+        sem_post_s(ipc->sem_done_cs);
+    }
+    chan_close(&ch);
+    free(ord_buf);
+#ifdef INCREMENTAL
+    free(segs);
+#endif
+}
+
+static void wait_counter(int sem, int *counter, int target) {
+    while (1) {
+        sem_wait_s(sem);
+        int d = *counter;
+        sem_post_s(sem);
+        if (d == target) break;
+        usleep(100);
+    }
+}
+
+/* job 하나: worker 들을 두 phase 로 돌리고 server 기록 완료까지 대기 */
+void daemon_run_job(const struct daemon_ipc *ipc,
+                    struct timeval *cc_s, struct timeval *cc_e,
+                    struct timeval *cs_s, struct timeval *cs_e) {
+    int i;
+
+    ipc->counters[1] = ipc->counters[2] = 0;
+
+    gettimeofday(cc_s, NULL);
+    for (i = 0; i < LOGICAL_SM; i++) sem_post_s(ipc->sem_go_cc);
+    wait_counter(ipc->sem_done_cc, &ipc->counters[1], LOGICAL_SM);
+    gettimeofday(cc_e, NULL);
+
+    gettimeofday(cs_s, NULL);
+    for (i = 0; i < LOGICAL_SM; i++) sem_post_s(ipc->sem_go_cs);
+    wait_counter(ipc->sem_done_cs, &ipc->counters[2], LOGICAL_SM);
+    gettimeofday(cs_e, NULL);
+
+    sem_op_n(ipc->sem_job, 0, -NUM_SERVERS);
+}
+
+/* 외부 client 역할: control queue 로 job 을 보내고 왕복 latency 기록 */
+void daemon_submitter(double *job_lat) {
+    struct ctrlbuf req, rep;
+    struct timeval s, e;
+    int ctrl, j;
+
+    ctrl = msgget(CTRL_KEY, 0666);
+    for (j = 0; j < NUM_JOBS; j++) {
+        req.mtype = CTRL_JOB;
+        req.job_id = j;
+        gettimeofday(&s, NULL);
+        msgsnd(ctrl, &req, sizeof(req.job_id), 0);
+        msgrcv(ctrl, &rep, sizeof(rep.job_id), CTRL_REPLY, 0);
+        gettimeofday(&e, NULL);
+        job_lat[j] = GET_DURATION(s, e);
+    }
+    req.mtype = CTRL_SHUTDOWN;
+    req.job_id = -1;
+    msgsnd(ctrl, &req, sizeof(req.job_id), 0);
+}
+#endif
+
+/* ===================== MULTI-TENANT ===================== */
+#ifdef NUM_TENANTS
+/*
+ * job 마다 queue 를 따로 두고, server 는 round 마다 job 별 deficit 에
+ * TENANT_QUANTUM byte 를 더해 그만큼만 꺼내 쓴다 (deficit round-robin).
+ * queue 가 비면 deficit 을 버리므로 큰 job 이 쌓아 둔 chunk 가 작은 job 을 밀어내지 못한다.
+ */
+struct tenant_stats {
+    long long first_ns[NUM_TENANTS];    /* 첫 chunk 수신 */
+    long long done_ns[NUM_TENANTS];     /* 마지막 chunk 기록 */
+    double bytes[NUM_TENANTS];
+    double shared_bytes[NUM_TENANTS];   /* 모든 job 이 남아 있는 동안 쓴 byte */
+    long chunks[NUM_TENANTS];
+    long rounds;                        /* chunk 를 하나라도 쓴 DRR round 수 */
+};
+
+void server_tenant(const int *queue, double *server_times,
+                   struct lat_hist (*hist)[HOP_COUNT], struct tenant_stats *ts) {
+    struct raid_set rs[NUM_TENANTS];
+    long deficit[NUM_TENANTS], expect[NUM_TENANTS];
+    struct msgbuf msg;
+    char dir[32];
+    int j, sm, active = NUM_TENANTS, progressed;
+    long long t0, recv_ns, done_ns;
+    double recv_time = 0, io_time = 0, cpu0 = cpu_seconds();
+
+    for (j = 0; j < NUM_TENANTS; j++) {
+        sprintf(dir, "job_%d", j);
+        if (mkdir(dir, 0755) < 0 && errno != EEXIST) { perror("mkdir job"); exit(1); }
+        raid_open(&rs[j], dir, 0, TENANT_PASSES(j));
+        deficit[j] = 0;
+        expect[j] = (long)TENANT_PASSES(j) * LOGICAL_SM * MSGS_PER_SM;
+    }
+
+    while (active > 0) {
+        progressed = 0;
+        for (j = 0; j < NUM_TENANTS; j++) {
+            if (ts->chunks[j] == expect[j]) continue;
+            deficit[j] += TENANT_QUANTUM;
+            while (deficit[j] >= (long)sizeof(msg.data)) {
+                t0 = now_ns();
+                if (msgrcv(queue[j], &msg, MSG_SIZE, 0, IPC_NOWAIT) == -1) {
+                    if (errno != ENOMSG) { perror("msgrcv(tenant)"); exit(1); }
+                    deficit[j] = 0;     /* 빈 queue 는 deficit 을 쌓지 않는다 */
+                    break;
+                }
+                recv_ns = now_ns();
+                recv_time += (recv_ns - t0) / 1e9;
+                if (ts->chunks[j] == 0) ts->first_ns[j] = recv_ns;
+
+                sm = (int)msg.mtype - 1;
+                raid_write(&rs[j], stripe_disk(sm), &msg);
+                done_ns = now_ns();
+                io_time += (done_ns - recv_ns) / 1e9;
+
+                hist_add(&hist[sm][HOP_QUEUE], recv_ns - msg.hdr.send_ns);
+                hist_add(&hist[sm][HOP_WRITE], done_ns - recv_ns);
+                hist_add(&hist[sm][HOP_E2E], done_ns - msg.hdr.send_ns);
+
+                deficit[j] -= sizeof(msg.data);
+                ts->bytes[j] += sizeof(msg.data);
+                if (active == NUM_TENANTS) ts->shared_bytes[j] += sizeof(msg.data);
+                progressed = 1;
+                if (++ts->chunks[j] == expect[j]) {
+                    ts->done_ns[j] = done_ns;
+                    deficit[j] = 0;
+                    active--;
+                    break;
+                }
+            }
+        }
+        if (progressed) ts->rounds++;
+        else usleep(20);
+    }
+
+    server_times[ST_RECV] = recv_time;
+    server_times[ST_IO] = io_time;
+    server_times[ST_CPU] = cpu_seconds() - cpu0;
+#ifdef DISK_EMU
+    disk_emu_store(server_times);
+#endif
+    for (j = 0; j < NUM_TENANTS; j++) {
+        server_times[ST_ENCODE] += rs[j].encode_time;
+        server_times[ST_RAW_BYTES] += rs[j].raw_bytes;
+        server_times[ST_DISK_BYTES] += rs[j].disk_bytes;
+#ifdef RAID_COMPRESS
+        raid_write_index(&rs[j]);
+#endif
+        raid_close(&rs[j]);
+    }
+}
+
+/* job 하나: dist 생성 → 재정렬 → 자기 queue 로 TENANT_PASSES(job) 번 전송 */
+void tenant_job(int job, int queue, const struct reorder_kernel *kernel, int sem_cc) {
+    int *dist = malloc(sizeof(int) * DATA_SIZE);
+    int *ord = malloc(sizeof(int) * DATA_SIZE);
+    struct chan ch;
+    int l, c, p;
+
+    for (l = 0; l < LOGICAL_SM; l++)
+        layout_fill(l, &dist[l * LOGICAL_CHUNK]);
+    for (l = 0; l < LOGICAL_SM; l++)
+        kernel->fn(dist, &ord[l * LOGICAL_CHUNK], l * (N / 8), (l + 1) * (N / 8), N);
+    sem_post_s(sem_cc);
+
+    ch.fd[0] = queue;
+    for (p = 0; p < TENANT_PASSES(job); p++)
+        for (l = 0; l < LOGICAL_SM; l++)
+            for (c = 0; c < MSGS_PER_SM; c++)
+                send_chunk(&ch, l, c, &ord[l * LOGICAL_CHUNK + c * CHUNK_INT]);
+    free(dist);
+    free(ord);
+}
+#endif
+
+/* ===================== COLLECTIVES ===================== */
+#ifdef COLLECTIVE
+/*
+ * SM shared memory 위의 collective. SM s 의 입력은 길이 COLL_ELEMS 인 벡터 in[s],
+ * slice d 는 원소 [d * COLL_SLICE, (d + 1) * COLL_SLICE).
+ *   allgather      : SM s 는 in[s] 의 slice s 를 내고, 모든 SM 이 slice 8 개를 모은다
+ *   reduce-scatter : SM d 는 slice d 를 8 개 입력에서 reduce
+ *   allreduce      : reduce-scatter 결과를 res 에 쓰고, barrier 뒤 res 를 allgather
+ * SM 마다 시작 source 를 (d + k) % 8 로 돌려 같은 입력에 몰리지 않게 한다.
+ * 벡터 byte 크기는 type 과 무관하게 DATA_SIZE * 4 라서 server 로 가는 slice 는
+ * 항상 MSGS_PER_SM 개 message 다.
+ */
+#if defined(COLL_DOUBLE)
+typedef double coll_t;
+#define COLL_TYPE 2
+#define COLL_TYPE_NAME "f64"
+#elif defined(COLL_FLOAT)
+typedef float coll_t;
+#define COLL_TYPE 1
+#define COLL_TYPE_NAME "f32"
+#else
+typedef int coll_t;
+#define COLL_TYPE 0
+#define COLL_TYPE_NAME "i32"
+#endif
+#if defined(COLL_MAX)
+#define COLL_OP 2
+#define COLL_SOP S_MAX
+#elif defined(COLL_MIN)
+#define COLL_OP 1
+#define COLL_SOP S_MIN
+#else
+#define COLL_OP 0
+#define COLL_SOP S_SUM
+#endif
+#if defined(COLL_ALLGATHER)
+#define COLL_NAME "allgather"
+#elif defined(COLL_REDUCE_SCATTER)
+#define COLL_NAME "reduce-scatter"
+#else
+#define COLL_NAME "allreduce"
+#endif
+
+#define COLL_ELEMS ((int)(DATA_SIZE * sizeof(int) / sizeof(coll_t)))
+#define COLL_SLICE (COLL_ELEMS / LOGICAL_SM)
+#define COLL_BLOCK (8192 / (int)sizeof(coll_t))    /* reduction 단위: acc 가 L1 에 남도록 */
+#if defined(COLL_REDUCE_SCATTER)
+#define COLL_OUT_ELEMS COLL_SLICE
+#else
+#define COLL_OUT_ELEMS COLL_ELEMS
+#endif
+
+/* acc[i] = acc[i] op x[i] */
+typedef void (*reduce_fn)(void *acc, const void *x, int n);
+
+struct reduce_kernel {
+    const char *name;
+    reduce_fn fn;
+};
+
+#define S_SUM(a, b) ((a) + (b))
+#define S_MIN(a, b) ((b) < (a) ? (b) : (a))
+#define S_MAX(a, b) ((b) > (a) ? (b) : (a))
+
+#if defined(__AVX2__)
+#define REDUCE_ISA "avx2"
+#define VI __m256i
+#define VF __m256
+#define VD __m256d
+#define WI 8
+#define WF 8
+#define WD 4
+#define LDI(p) _mm256_loadu_si256((const __m256i *)(p))
+#define STI(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#define LDF(p) _mm256_loadu_ps(p)
+#define STF(p, v) _mm256_storeu_ps(p, v)
+#define LDD(p) _mm256_loadu_pd(p)
+#define STD(p, v) _mm256_storeu_pd(p, v)
+#define ADDI _mm256_add_epi32
+#define MINI _mm256_min_epi32
+#define MAXI _mm256_max_epi32
+#define ADDF _mm256_add_ps
+#define MINF _mm256_min_ps
+#define MAXF _mm256_max_ps
+#define ADDD _mm256_add_pd
+#define MIND _mm256_min_pd
+#define MAXD _mm256_max_pd
+#elif defined(__SSE2__)
+#define VI __m128i
+#define VF __m128
+#define VD __m128d
+#define WI 4
+#define WF 4
+#define WD 2
+#define LDI(p) _mm_loadu_si128((const __m128i *)(p))
+#define STI(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#define LDF(p) _mm_loadu_ps(p)
+#define STF(p, v) _mm_storeu_ps(p, v)
+#define LDD(p) _mm_loadu_pd(p)
+#define STD(p, v) _mm_storeu_pd(p, v)
+#define ADDI _mm_add_epi32
+#define ADDF _mm_add_ps
+#define MINF _mm_min_ps
+#define MAXF _mm_max_ps
+#define ADDD _mm_add_pd
+#define MIND _mm_min_pd
+#define MAXD _mm_max_pd
+#if defined(__SSE4_1__)
+#define REDUCE_ISA "sse4.1"
+#define MINI _mm_min_epi32
+#define MAXI _mm_max_epi32
+#else
+#define REDUCE_ISA "sse2"
+/* SSE2 에는 signed 32-bit min/max 가 없어서 비교 mask 로 고른다 */
+static inline __m128i mm_min_epi32(__m128i a, __m128i b) {
+    __m128i m = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a));
+}
+static inline __m128i mm_max_epi32(__m128i a, __m128i b) {
+    __m128i m = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+#define MINI mm_min_epi32
+#define MAXI mm_max_epi32
+#endif
+#endif
+
+#ifdef REDUCE_ISA
+/* 두 벡터씩 펼친 본체 + scalar 꼬리 */
+#define DEFINE_REDUCE(NAME, T, VT, W, LD, ST, VOP, SOP) \
+static void NAME(void *acc_, const void *x_, int n) \
+{ \
+    T *acc = acc_; \
+    const T *x = x_; \
+    int i = 0; \
+    for (; i + 2 * (W) <= n; i += 2 * (W)) { \
+        VT a0 = VOP(LD(&acc[i]), LD(&x[i])); \
+        VT a1 = VOP(LD(&acc[i + (W)]), LD(&x[i + (W)])); \
+        ST(&acc[i], a0); \
+        ST(&acc[i + (W)], a1); \
+    } \
+    for (; i < n; i++) acc[i] = SOP(acc[i], x[i]); \
+}
+#else
+#define REDUCE_ISA "scalar"
+#define DEFINE_REDUCE(NAME, T, VT, W, LD, ST, VOP, SOP) \
+static void NAME(void *acc_, const void *x_, int n) \
+{ \
+    T *acc = acc_; \
+    const T *x = x_; \
+    int i; \
+    for (i = 0; i < n; i++) acc[i] = SOP(acc[i], x[i]); \
+}
+#endif
+
+DEFINE_REDUCE(reduce_sum_i32, int, VI, WI, LDI, STI, ADDI, S_SUM)
+DEFINE_REDUCE(reduce_min_i32, int, VI, WI, LDI, STI, MINI, S_MIN)
+DEFINE_REDUCE(reduce_max_i32, int, VI, WI, LDI, STI, MAXI, S_MAX)
+DEFINE_REDUCE(reduce_sum_f32, float, VF, WF, LDF, STF, ADDF, S_SUM)
+DEFINE_REDUCE(reduce_min_f32, float, VF, WF, LDF, STF, MINF, S_MIN)
+DEFINE_REDUCE(reduce_max_f32, float, VF, WF, LDF, STF, MAXF, S_MAX)
+DEFINE_REDUCE(reduce_sum_f64, double, VD, WD, LDD, STD, ADDD, S_SUM)
+DEFINE_REDUCE(reduce_min_f64, double, VD, WD, LDD, STD, MIND, S_MIN)
+DEFINE_REDUCE(reduce_max_f64, double, VD, WD, LDD, STD, MAXD, S_MAX)
+
+/* [type][op] */
+static const struct reduce_kernel reduce_kernels[3][3] = {
+    { { "sum_i32", reduce_sum_i32 }, { "min_i32", reduce_min_i32 }, { "max_i32", reduce_max_i32 } },
+    { { "sum_f32", reduce_sum_f32 }, { "min_f32", reduce_min_f32 }, { "max_f32", reduce_max_f32 } },
+    { { "sum_f64", reduce_sum_f64 }, { "min_f64", reduce_min_f64 }, { "max_f64", reduce_max_f64 } }
+};
+
+/* SM s 입력의 i 번째. 작은 정수라 float 합도 순서와 관계없이 정확하다 */
+static coll_t coll_input(int s, int i) {
+    return (coll_t)((int)(((long long)i * 7 + s * 131) % 1021) - 510);
+}
+
+void coll_fill(int s, coll_t *in) {
+    int i;
+
+    for (i = 0; i < COLL_ELEMS; i++) in[i] = coll_input(s, i);
+}
+
+#ifndef COLL_ALLGATHER
+/* slice d 를 8 개 입력에서 reduce 해 out 에 (COLL_BLOCK 단위로 끊어 acc 를 cache 에) */
+static void coll_reduce_slice(const struct reduce_kernel *rk, const coll_t *in, int d,
+                              coll_t *out) {
+    int b, k, s, len;
+
+    for (b = 0; b < COLL_SLICE; b += len) {
+        len = COLL_SLICE - b < COLL_BLOCK ? COLL_SLICE - b : COLL_BLOCK;
+        memcpy(&out[b], &in[d * COLL_ELEMS + d * COLL_SLICE + b], sizeof(coll_t) * len);
+        for (k = 1; k < LOGICAL_SM; k++) {
+            s = (d + k) % LOGICAL_SM;
+            rk->fn(&out[b], &in[s * COLL_ELEMS + d * COLL_SLICE + b], len);
+        }
+    }
+}
+#endif
+
+#ifndef COLL_REDUCE_SCATTER
+/* slice s 를 src[s * stride + s * COLL_SLICE] 에서 모은다 */
+static void coll_gather(const coll_t *src, int stride, int d, coll_t *out) {
+    int k, s;
+
+    for (k = 0; k < LOGICAL_SM; k++) {
+        s = (d + k) % LOGICAL_SM;
+        memcpy(&out[s * COLL_SLICE], &src[s * stride + s * COLL_SLICE],
+               sizeof(coll_t) * COLL_SLICE);
+    }
+}
+#endif
+
+/* SM sm 의 collective. sem_bar 는 LOGICAL_SM 으로 초기화된 1 회용 barrier */
+void coll_run(const struct reduce_kernel *rk, int sm, const coll_t *in, coll_t *res,
+              coll_t *out, int sem_bar) {
+#if defined(COLL_REDUCE_SCATTER)
+    (void)res;
+    (void)sem_bar;
+    coll_reduce_slice(rk, in, sm, out);
+#elif defined(COLL_ALLGATHER)
+    (void)rk;
+    (void)res;
+    (void)sem_bar;
+    coll_gather(in, COLL_ELEMS, sm, out);
+#else
+    coll_reduce_slice(rk, in, sm, &res[sm * COLL_SLICE]);
+    sem_op_n(sem_bar, 0, -1);
+    sem_op_n(sem_bar, 0, 0);
+    coll_gather(res, 0, sm, out);
+#endif
+}
+
+/* server 로 보낼 slice */
+const coll_t *coll_slice(int sm, const coll_t *out) {
+#if defined(COLL_REDUCE_SCATTER)
+    (void)sm;
+    return out;
+#else
+    return &out[sm * COLL_SLICE];
+#endif
+}
+
+/* 결과를 입력 공식에서 다시 계산해 대조, 틀린 원소 수 */
+long coll_verify(int sm, const coll_t *out) {
+    int i, j, s, base = 0;
+    long bad = 0;
+    coll_t want;
+
+#if defined(COLL_REDUCE_SCATTER)
+    base = sm * COLL_SLICE;
+#endif
+    for (i = 0; i < COLL_OUT_ELEMS; i++) {
+        j = base + i;
+#if defined(COLL_ALLGATHER)
+        want = coll_input(j / COLL_SLICE, j);
+#else
+        want = coll_input(0, j);
+        for (s = 1; s < LOGICAL_SM; s++) want = COLL_SOP(want, coll_input(s, j));
+#endif
+        if (out[i] != want) {
+            if (!bad)
+                fprintf(stderr, "[ERROR] %s sm=%d: [%d] = %g, expected %g\n", COLL_NAME,
+                        sm, j, (double)out[i], (double)want);
+            bad++;
+        }
+    }
+    (void)s;
+    return bad;
+}
+#endif
+
+/* ===================== MAIN ===================== */
+int main() {
+#ifdef DIST_SEGMENT
+    int shmid;
+    int *shared;
+#endif
+#ifdef COLLECTIVE
+    const struct reduce_kernel *rk = &reduce_kernels[COLL_TYPE][COLL_OP];
+    long coll_bad = 0;
+    double coll_bw;
+#endif
+#ifdef EXCHANGE_VM
+    int peer_shmid;
+    struct vm_peer *peers;
+    long vm_calls, vm_iovs;
+    long long vm_bytes;
+#endif
+    union semun arg;
+    int i;
+    size_t shm_bytes;
+    struct rusage ru_self, ru_child;
+#if defined(REDIST_INPLACE)
+    struct cycle_plan plan;
+    struct timeval plan_s, plan_e;
+    long max_moved;
+#elif defined(REDIST_PLAN)
+    const struct reorder_kernel *kernel;
+    struct timeval plan_s, plan_e;
+#elif !defined(OUT_OF_CORE) && !defined(PUSH_MODE) && !defined(EXCHANGE_VM) && \
+      !defined(COLLECTIVE)
+    const struct reorder_kernel *kernel;
+#endif
+#ifdef ORD_SEGMENT
+    int ord_shmid;
+    int *ord_shm;
+#endif
+#ifdef WORK_STEALING
+    int ws_shmid;
+    struct ws_shared *ws;
+#endif
+#ifdef DAEMON_MODE
+    struct timeval cold_s, cold_e;
+    int sem_job;
+    double first_job, warm_sum, warm_min, warm_max;
+#endif
+#ifdef INCREMENTAL
+    int incr_shmid;
+    struct incr_shared *incr;
+    int *tile_frame;
+    long incr_bad;
+#endif
+    
+    /* Shared memory for server timing results */
+    int server_time_shmid;
+    double *server_times;
+    double srv[ST_COUNT];                 /* server 병합 결과 */
+    int hist_shmid;
+    struct lat_hist (*hist)[HOP_COUNT];   /* [LOGICAL_SM][HOP_COUNT] */
+    int hop;
+#ifdef RAID_COMPRESS
+    long long raw_bytes;
+    double dec_time;
+    long dec_bad;
+#endif
+#ifdef NUM_TENANTS
+    int tenant_q[NUM_TENANTS];
+    int tenant_shmid, sem_tenant;
+    struct tenant_stats *ts;
+    double tput, tput_sum, tput_sq;
+#endif
+    
+    /* Barrier semaphores */
+    int sem_ready, sem_go_cc, sem_done_cc, sem_go_cs, sem_done_cs;
+    int *counters;  /* [0]=ready, [1]=done_cc, [2]=done_cs, [3]=shutdown */
+    int counter_shmid;
+    
+    struct timeval total_cc_s, total_cc_e, total_cs_s, total_cs_e;
+    
+#ifdef DAEMON_MODE
+    gettimeofday(&cold_s, NULL);
+#endif
+    
+#ifdef REDIST_PLAN
+    /* 잘못된 layout 이면 여기서 끝나도록 IPC 자원을 만들기 전에 만든다 */
+    gettimeofday(&plan_s, NULL);
+    redist_plan_build(&redist_active, &redist_src_layout, &redist_dst_layout);
+    gettimeofday(&plan_e, NULL);
+#endif
+    
+    /* Create shared memory */
+#if defined(DIST_SEGMENT)
+    shmid = shmget(IPC_PRIVATE, sizeof(int) * DATA_SIZE * NUM_FIELDS, IPC_CREAT | 0666);
+    if (shmid == -1) { perror("shmget(dist)"); exit(1); }
+    shared = shmat(shmid, NULL, 0);
+    shm_bytes = sizeof(int) * DATA_SIZE * NUM_FIELDS;
+#elif defined(EXCHANGE_VM)
+    /* dist 는 SM 마다 private, 공유하는 건 (pid, 주소) table 뿐 */
+    peer_shmid = shmget(IPC_PRIVATE, sizeof(struct vm_peer) * LOGICAL_SM, IPC_CREAT | 0666);
+    peers = shmat(peer_shmid, NULL, 0);
+    memset(peers, 0, sizeof(struct vm_peer) * LOGICAL_SM);
+    shm_bytes = sizeof(struct vm_peer) * LOGICAL_SM;
+#else
+    shm_bytes = 0;
+#endif
+    
+    /* [NUM_SERVERS][ST_COUNT] */
+    server_time_shmid = shmget(IPC_PRIVATE, sizeof(double) * ST_COUNT * NUM_SERVERS,
+                               IPC_CREAT | 0666);
+    server_times = shmat(server_time_shmid, NULL, 0);
+    memset(server_times, 0, sizeof(double) * ST_COUNT * NUM_SERVERS);
+    
+    hist_shmid = shmget(IPC_PRIVATE, sizeof(struct lat_hist) * LOGICAL_SM * HOP_COUNT,
+                        IPC_CREAT | 0666);
+    hist = shmat(hist_shmid, NULL, 0);
+    memset(hist, 0, sizeof(struct lat_hist) * LOGICAL_SM * HOP_COUNT);
+    shm_bytes += sizeof(struct lat_hist) * LOGICAL_SM * HOP_COUNT;
+    
+    counter_shmid = shmget(IPC_PRIVATE, sizeof(int) * 4, IPC_CREAT | 0666);
+    counters = shmat(counter_shmid, NULL, 0);
+    shm_bytes += sizeof(double) * ST_COUNT * NUM_SERVERS + sizeof(int) * 4;
+    counters[0] = counters[1] = counters[2] = counters[3] = 0;
+    
+#ifdef ORD_SEGMENT
+    /* 다른 SM 이 쓴 결과도 원래 domain 위치에 모이도록 ord 를 공유 */
+    ord_shmid = shmget(IPC_PRIVATE, sizeof(int) * DATA_SIZE, IPC_CREAT | 0666);
+    ord_shm = shmat(ord_shmid, NULL, 0);
+    shm_bytes += sizeof(int) * DATA_SIZE;
+#endif
+#ifdef WORK_STEALING
+    ws_shmid = shmget(IPC_PRIVATE, sizeof(struct ws_shared), IPC_CREAT | 0666);
+    ws = shmat(ws_shmid, NULL, 0);
+    ws_init(ws);
+    shm_bytes += sizeof(struct ws_shared);
+#endif
+    
+    /* Semaphores */
+    sem_ready = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+    sem_go_cc = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+    sem_done_cc = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+    sem_go_cs = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+    sem_done_cs = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+    
+    arg.val = 1;
+    semctl(sem_ready, 0, SETVAL, arg);
+    semctl(sem_done_cc, 0, SETVAL, arg);
+    semctl(sem_done_cs, 0, SETVAL, arg);
+    
+    arg.val = 0;
+    semctl(sem_go_cc, 0, SETVAL, arg);
+    semctl(sem_go_cs, 0, SETVAL, arg);
+    
+#ifdef DAEMON_MODE
+    sem_job = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+    semctl(sem_job, 0, SETVAL, arg);
+#endif
+    
+    shm_bytes += dump_init();
+    
+#ifdef NUM_TENANTS
+    /* job 마다 private queue: 같은 host 의 다른 실행과 key 가 겹치지 않는다 */
+    for (i = 0; i < NUM_TENANTS; i++) {
+        tenant_q[i] = msgget(IPC_PRIVATE, IPC_CREAT | 0666);
+        if (tenant_q[i] == -1) { perror("msgget(tenant)"); exit(1); }
+    }
+    tenant_shmid = shmget(IPC_PRIVATE, sizeof(struct tenant_stats), IPC_CREAT | 0666);
+    ts = shmat(tenant_shmid, NULL, 0);
+    memset(ts, 0, sizeof(struct tenant_stats));
+    shm_bytes += sizeof(struct tenant_stats);
+    sem_tenant = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+    arg.val = 0;
+    semctl(sem_tenant, 0, SETVAL, arg);
+#endif
+    
+#ifdef TRANSPORT_SPLICE
+    splice_init();
+#endif
+    
+    /* Fork servers */
+    for (i = 0; i < NUM_SERVERS; i++) {
+        if (fork() == 0) {
+#if defined(NUM_TENANTS)
+            server_tenant(tenant_q, server_times, hist, ts);
+#elif defined(DAEMON_MODE)
+            server_daemon(i, &server_times[i * ST_COUNT], hist, sem_job);
+#else
+            server_run(i, &server_times[i * ST_COUNT], hist);
+#endif
+            exit(0);
+        }
+    }
+    
+    usleep(10000);
+
+#if defined(REDIST_INPLACE)
+    gettimeofday(&plan_s, NULL);
+    build_cycle_plan(&plan);
+    gettimeofday(&plan_e, NULL);
+#elif !defined(OUT_OF_CORE) && !defined(PUSH_MODE) && !defined(EXCHANGE_VM) && \
+      !defined(COLLECTIVE)
+    kernel = select_reorder_kernel(N);
+#endif
+
+#if defined(OUT_OF_CORE)
+#if defined(GRID_8x8)
+    printf("=== [GRID_8x8] out-of-core, %d-row band window (N=%d) ===\n", BAND_ROWS, N);
+#else
+    printf("=== [GRID_4x4] out-of-core, %d-row band window (N=%d) ===\n", BAND_ROWS, N);
+#endif
+    printf("[KERNEL] band window (%d bands)\n\n", NUM_BANDS);
+    fflush(stdout);
+    
+    {
+    int win_shmid, sem_free, sem_full;
+    int *window;
+    
+    win_shmid = shmget(IPC_PRIVATE, sizeof(int) * 2 * BAND_SIZE, IPC_CREAT | 0666);
+    window = shmat(win_shmid, NULL, 0);
+    shm_bytes += sizeof(int) * 2 * BAND_SIZE;
+    
+    sem_free = semget(IPC_PRIVATE, 2 * LOGICAL_SM, IPC_CREAT | 0666);
+    sem_full = semget(IPC_PRIVATE, 2, IPC_CREAT | 0666);
+    arg.val = 1;
+    for (i = 0; i < 2 * LOGICAL_SM; i++) semctl(sem_free, i, SETVAL, arg);
+    arg.val = 0;
+    semctl(sem_full, 0, SETVAL, arg);
+    semctl(sem_full, 1, SETVAL, arg);
+    
+    /* Phase 1: dist 파일 생성 */
+    for (i = 0; i < LOGICAL_SM; i++) {
+        if (fork() == 0) {
+            write_dist_file(i);
+            exit(0);
+        }
+    }
+    for (i = 0; i < LOGICAL_SM; i++) wait(NULL);
+    printf("[Phase 1] dist 생성 완료\n\n");
+    fflush(stdout);
+    
+    counters[0] = counters[1] = 0;
+    
+    /* Phase 2 & 3: band 단위 재정렬 + 전송 (겹쳐서 진행) */
+    for (i = 0; i < LOGICAL_SM; i++) {
+        if (fork() == 0) {
+            sem_wait_s(sem_ready);
+            counters[0]++;
+            sem_post_s(sem_ready);
+            
+            sem_wait_s(sem_go_cc);
+            ooc_run_sm(i, window, sem_free, sem_full);
+            
+            sem_wait_s(sem_done_cc);
+            counters[1]++;
+            sem_post_s(sem_done_cc);
+            exit(0);
+        }
+    }
+    
+    while (1) {
+        sem_wait_s(sem_ready);
+        int r = counters[0];
+        sem_post_s(sem_ready);
+        if (r == LOGICAL_SM) break;
+        usleep(100);
+    }
+    
+    gettimeofday(&total_cc_s, NULL);
+    for (i = 0; i < LOGICAL_SM; i++) sem_post_s(sem_go_cc);
+    
+    while (1) {
+        sem_wait_s(sem_done_cc);
+        int d = counters[1];
+        sem_post_s(sem_done_cc);
+        if (d == LOGICAL_SM) break;
+        usleep(100);
+    }
+    gettimeofday(&total_cc_e, NULL);
+    /* 전송은 band 재정렬과 겹쳐 있으므로 CLIENT-CLIENT 에 포함 */
+    total_cs_s = total_cs_e = total_cc_e;
+    
+    for (i = 0; i < LOGICAL_SM; i++) wait(NULL);
+    
+    shmdt(window);
+    shmctl(win_shmid, IPC_RMID, NULL);
+    semctl(sem_free, 0, IPC_RMID);
+    semctl(sem_full, 0, IPC_RMID);
+    }
+
+#elif defined(DAEMON_MODE)
+#if defined(GRID_8x8)
+    printf("=== [GRID_8x8] daemon, %d jobs (N=%d) ===\n", NUM_JOBS, N);
+#else
+    printf("=== [GRID_4x4] daemon, %d jobs (N=%d) ===\n", NUM_JOBS, N);
+#endif
+    printf("[KERNEL] %s\n\n", kernel->name);
+    fflush(stdout);
+    
+    {
+    struct daemon_ipc ipc;
+    struct ctrlbuf req, rep;
+    int ctrl, lat_shmid;
+    double *job_lat;
+    
+    ipc.shared = shared;
+    ipc.counters = counters;
+    ipc.sem_ready = sem_ready;
+    ipc.sem_go_cc = sem_go_cc;
+    ipc.sem_done_cc = sem_done_cc;
+    ipc.sem_go_cs = sem_go_cs;
+    ipc.sem_done_cs = sem_done_cs;
+    ipc.sem_job = sem_job;
+#ifdef INCREMENTAL
+    incr_shmid = shmget(IPC_PRIVATE, sizeof(struct incr_shared), IPC_CREAT | 0666);
+    incr = shmat(incr_shmid, NULL, 0);
+    memset(incr, 0, sizeof(*incr));
+    shm_bytes += sizeof(struct incr_shared);
+    ipc.incr = incr;
+    tile_frame = calloc(DIRTY_TILES, sizeof(int));   /* tile 별 마지막으로 쓴 frame */
+#endif
+    
+    ctrl = msgget(CTRL_KEY, IPC_CREAT | 0666);
+    if (ctrl == -1) { perror("msgget(ctrl)"); exit(1); }
+    lat_shmid = shmget(IPC_PRIVATE, sizeof(double) * NUM_JOBS, IPC_CREAT | 0666);
+    job_lat = shmat(lat_shmid, NULL, 0);
+    shm_bytes += sizeof(double) * NUM_JOBS;
+    
+    /* Phase 1: job 입력 (dist) 을 shared 에 올려 둔다 */
+    for (i = 0; i < LOGICAL_SM; i++) {
+        if (fork() == 0) {
+            layout_fill(i, &shared[i * LOGICAL_CHUNK]);
+#ifdef DUMP_LAYOUT
+            dump_dist(i, &shared[i * LOGICAL_CHUNK]);
+#endif
+            exit(0);
+        }
     }
-
-    total_msgs = LOGICAL_SM * 2;  /* 8 * 2 = 16 */
-
-    for (i = 0; i < total_msgs; i++) {
-        gettimeofday(&c2s_s, NULL);
-        if (msgrcv(msqid, &msg, sizeof(msg.data), 0, 0) == -1) {
-            perror("msgrcv"); exit(1);
+    for (i = 0; i < LOGICAL_SM; i++) wait(NULL);
+    
+    /* 상주 worker */
+    counters[0] = 0;
+    for (i = 0; i < LOGICAL_SM; i++) {
+        if (fork() == 0) {
+            daemon_worker(i, &ipc, kernel);
+            exit(0);
         }
-        gettimeofday(&c2s_e, NULL);
-        c2s_time += GET_DURATION(c2s_s, c2s_e);
-
-        sm = (int)msg.mtype - 1;
-        disk = sm % 4;
-
-        gettimeofday(&io_s, NULL);
-        fwrite(msg.data, sizeof(int), CHUNK_INT, raid[disk]);
-        fflush(raid[disk]);
-        gettimeofday(&io_e, NULL);
-        io_time += GET_DURATION(io_s, io_e);
     }
-
-    /* Store times to shared memory */
-    server_times[0] = c2s_time;
-    server_times[1] = io_time;
-
-    for (i = 0; i < 4; i++) fclose(raid[i]);
-    msgctl(msqid, IPC_RMID, NULL);
-}
-
-/* ===================== DIST FUNCTIONS ===================== */
-void make_dist_4x4(int logical_sm, int *out) {
-    const int TILE = 16;
-    int idx = 0;
-    int tile_col = logical_sm % 4;
-    int tile_row = logical_sm / 4;
-    int repeat, base_tile_row, base_row, r, c;
+    wait_counter(sem_ready, &counters[0], LOGICAL_SM);
+    gettimeofday(&cold_e, NULL);
+    printf("[Phase 1] dist 생성 + worker 준비 완료\n\n");
+    fflush(stdout);
     
-    for (repeat = 0; repeat < 2; repeat++) {
-        base_tile_row = tile_row + repeat * 2;
-        base_row = base_tile_row * TILE;
-        for (r = base_row; r < base_row + TILE; r++) {
-            for (c = tile_col * TILE; c < (tile_col + 1) * TILE; c++) {
-                out[idx++] = r * 64 + c;
-            }
+    if (fork() == 0) {
+        daemon_submitter(job_lat);
+        exit(0);
+    }
+    
+    /* control loop */
+    while (1) {
+        if (msgrcv(ctrl, &req, sizeof(req.job_id), -CTRL_SHUTDOWN, 0) == -1) {
+            perror("msgrcv(ctrl)"); exit(1);
         }
+        if (req.mtype == CTRL_SHUTDOWN) break;
+#ifdef INCREMENTAL
+        incr_next_frame(shared, incr, tile_frame, req.job_id);
+#endif
+        daemon_run_job(&ipc, &total_cc_s, &total_cc_e, &total_cs_s, &total_cs_e);
+#ifdef INCREMENTAL
+        incr_end_frame(incr, req.job_id);
+#endif
+        rep.mtype = CTRL_REPLY;
+        rep.job_id = req.job_id;
+        msgsnd(ctrl, &rep, sizeof(rep.job_id), 0);
+    }
+    
+    /* worker, server 종료 */
+    counters[3] = 1;
+    for (i = 0; i < LOGICAL_SM; i++) sem_post_s(sem_go_cc);
+    {
+        struct msgbuf bye;
+        struct chan ch;
+        chan_open(&ch);
+        memset(&bye, 0, sizeof(bye));
+        bye.mtype = LOGICAL_SM + 1;
+        for (i = 0; i < NUM_SERVERS; i++) chan_send_to(&ch, i, &bye);
+        chan_close(&ch);
+    }
+    for (i = 0; i < LOGICAL_SM + NUM_SERVERS; i++) wait(NULL);
+    
+    warm_sum = 0;
+    warm_min = warm_max = NUM_JOBS > 1 ? job_lat[1] : 0;
+    for (i = 1; i < NUM_JOBS; i++) {
+        warm_sum += job_lat[i];
+        if (job_lat[i] < warm_min) warm_min = job_lat[i];
+        if (job_lat[i] > warm_max) warm_max = job_lat[i];
+    }
+    first_job = job_lat[0];
+#ifdef INCREMENTAL
+    incr_bad = incr_verify(tile_frame);
+    free(tile_frame);
+#endif
+    
+    shmdt(job_lat);
+    shmctl(lat_shmid, IPC_RMID, NULL);
+    msgctl(ctrl, IPC_RMID, NULL);
+    semctl(sem_job, 0, IPC_RMID);
     }
-}
 
-void make_dist_8x8(int sm, int *out) {
-    int cols_per_sm = N / 8;
-    int start_col = sm * cols_per_sm;
-    int end_col = start_col + cols_per_sm;
-    int idx = 0;
-    int r, c;
+#elif defined(NUM_TENANTS)
+#if defined(GRID_8x8)
+    printf("=== [GRID_8x8] %d tenants, DRR quantum %d bytes (N=%d) ===\n",
+           NUM_TENANTS, TENANT_QUANTUM, N);
+#else
+    printf("=== [GRID_4x4] %d tenants, DRR quantum %d bytes (N=%d) ===\n",
+           NUM_TENANTS, TENANT_QUANTUM, N);
+#endif
+    printf("[KERNEL] %s\n\n", kernel->name);
+    fflush(stdout);
     
-    for (r = 0; r < N; r++) {
-        for (c = start_col; c < end_col; c++) {
-            out[idx++] = r * N + c;
+    gettimeofday(&total_cc_s, NULL);
+    for (i = 0; i < NUM_TENANTS; i++) {
+        if (fork() == 0) {
+            tenant_job(i, tenant_q[i], kernel, sem_tenant);
+            exit(0);
         }
     }
-}
+    /* 모든 job 의 재정렬이 끝날 때까지가 CLIENT-CLIENT */
+    sem_op_n(sem_tenant, 0, -NUM_TENANTS);
+    gettimeofday(&total_cc_e, NULL);
+    total_cs_s = total_cc_e;
+    for (i = 0; i < NUM_TENANTS; i++) wait(NULL);
+    gettimeofday(&total_cs_e, NULL);
 
-/* ===================== MAIN ===================== */
-int main() {
-    int shmid, semid;
-    int *shared;
-    union semun arg;
-    int i;
-    
-    /* Shared memory for server timing results */
-    int server_time_shmid;
-    double *server_times;
+#elif defined(COLLECTIVE)
+#if defined(GRID_8x8)
+    printf("=== [GRID_8x8] %s, %d SM (N=%d, %d elems x %d bytes per SM) ===\n",
+#else
+    printf("=== [GRID_4x4] %s, %d SM (N=%d, %d elems x %d bytes per SM) ===\n",
+#endif
+           COLL_NAME, LOGICAL_SM, N, COLL_ELEMS, (int)sizeof(coll_t));
+#if defined(COLL_ALLGATHER)
+    printf("[KERNEL] gather (memcpy)\n\n");
+#else
+    printf("[KERNEL] reduce_%s (%s)\n\n", rk->name, REDUCE_ISA);
+#endif
+    fflush(stdout);
     
-    /* Barrier semaphores */
-    int sem_ready, sem_go_cc, sem_done_cc, sem_go_cs, sem_done_cs;
-    int *counters;  /* [0]=ready, [1]=done_cc, [2]=done_cs */
-    int counter_shmid;
+    {
+    int coll_shmid, sem_bar, l;
+    coll_t *coll_in, *coll_res;
+    long *bad;
     
-    struct timeval total_cc_s, total_cc_e, total_cs_s, total_cs_e;
+    /* 입력 [LOGICAL_SM][COLL_ELEMS] + allreduce 중간 결과 + SM 별 검증 결과 */
+    coll_shmid = shmget(IPC_PRIVATE, sizeof(coll_t) * COLL_ELEMS * (LOGICAL_SM + 1) +
+                        sizeof(long) * LOGICAL_SM, IPC_CREAT | 0666);
+    if (coll_shmid == -1) { perror("shmget(collective)"); exit(1); }
+    coll_in = shmat(coll_shmid, NULL, 0);
+    coll_res = &coll_in[LOGICAL_SM * COLL_ELEMS];
+    bad = (long *)&coll_res[COLL_ELEMS];
+    shm_bytes += sizeof(coll_t) * COLL_ELEMS * (LOGICAL_SM + 1) + sizeof(long) * LOGICAL_SM;
     
-    /* Create shared memory */
-    shmid = shmget(IPC_PRIVATE, sizeof(int) * DATA_SIZE, IPC_CREAT | 0666);
-    shared = shmat(shmid, NULL, 0);
+    sem_bar = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+    arg.val = LOGICAL_SM;
+    semctl(sem_bar, 0, SETVAL, arg);
     
-    server_time_shmid = shmget(IPC_PRIVATE, sizeof(double) * 2, IPC_CREAT | 0666);
-    server_times = shmat(server_time_shmid, NULL, 0);
+    for (l = 0; l < LOGICAL_SM; l++) {
+        if (fork() == 0) {
+            coll_t *out = malloc(sizeof(coll_t) * COLL_OUT_ELEMS);
+            const int *slice;
+            struct chan ch;
+            int c;
+            
+            /* Phase 1: 입력 생성, 결과 buffer 도 미리 page 를 잡아 둔다 */
+            coll_fill(l, &coll_in[l * COLL_ELEMS]);
+            memset(out, 0, sizeof(coll_t) * COLL_OUT_ELEMS);
+            
+            sem_wait_s(sem_ready);
+            counters[0]++;
+            sem_post_s(sem_ready);
+            
+            /* Phase 2: collective */
+            sem_wait_s(sem_go_cc);
+            coll_run(rk, l, coll_in, coll_res, out, sem_bar);
+            
+            sem_wait_s(sem_done_cc);
+            counters[1]++;
+            sem_post_s(sem_done_cc);
+            
+            /* Phase 3: 자기 slice 를 server 로 */
+            sem_wait_s(sem_go_cs);
+            slice = (const int *)coll_slice(l, out);
+            dump_buffer(DUMP_ORD, l, 0, slice, LOGICAL_CHUNK);
+            chan_open(&ch);
+            for (c = 0; c < MSGS_PER_SM; c++)
+                send_chunk(&ch, l, c, &slice[c * CHUNK_INT]);
+            chan_close(&ch);
+            
+            sem_wait_s(sem_done_cs);
+            counters[2]++;
+            sem_post_s(sem_done_cs);
+            
+            /* 검증은 시간 측정 밖에서 */
+            bad[l] = coll_verify(l, out);
+            free(out);
+            exit(0);
+        }
+    }
     
-    counter_shmid = shmget(IPC_PRIVATE, sizeof(int) * 3, IPC_CREAT | 0666);
-    counters = shmat(counter_shmid, NULL, 0);
-    counters[0] = counters[1] = counters[2] = 0;
+    while (1) {
+        sem_wait_s(sem_ready);
+        int r = counters[0];
+        sem_post_s(sem_ready);
+        if (r == LOGICAL_SM) break;
+        usleep(100);
+    }
+    printf("[Phase 1] 입력 생성 완료\n\n");
+    fflush(stdout);
     
-    /* Semaphores */
-    semid = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
-    sem_ready = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
-    sem_go_cc = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
-    sem_done_cc = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
-    sem_go_cs = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
-    sem_done_cs = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
+    gettimeofday(&total_cc_s, NULL);
+    for (l = 0; l < LOGICAL_SM; l++) sem_post_s(sem_go_cc);
+    while (1) {
+        sem_wait_s(sem_done_cc);
+        int d = counters[1];
+        sem_post_s(sem_done_cc);
+        if (d == LOGICAL_SM) break;
+        usleep(100);
+    }
+    gettimeofday(&total_cc_e, NULL);
     
-    arg.val = 1;
-    semctl(semid, 0, SETVAL, arg);
-    semctl(sem_ready, 0, SETVAL, arg);
-    semctl(sem_done_cc, 0, SETVAL, arg);
-    semctl(sem_done_cs, 0, SETVAL, arg);
+    gettimeofday(&total_cs_s, NULL);
+    for (l = 0; l < LOGICAL_SM; l++) sem_post_s(sem_go_cs);
+    while (1) {
+        sem_wait_s(sem_done_cs);
+        int d = counters[2];
+        sem_post_s(sem_done_cs);
+        if (d == LOGICAL_SM) break;
+        usleep(100);
+    }
+    gettimeofday(&total_cs_e, NULL);
     
-    arg.val = 0;
-    semctl(sem_go_cc, 0, SETVAL, arg);
-    semctl(sem_go_cs, 0, SETVAL, arg);
+    for (l = 0; l < LOGICAL_SM; l++) wait(NULL);
+    for (l = 0; l < LOGICAL_SM; l++) coll_bad += bad[l];
     
-    /* Fork server */
-    if (fork() == 0) {
-        server_run(server_times);
-        exit(0);
+    shmdt(coll_in);
+    shmctl(coll_shmid, IPC_RMID, NULL);
+    semctl(sem_bar, 0, IPC_RMID);
     }
-    
-    usleep(10000);
 
+#elif defined(GRID_8x8)
+    printf("=== [GRID_8x8] 8 SM parallel execution (N=%d) ===\n", N);
+#if defined(REDIST_INPLACE)
+    printf("[KERNEL] inplace_cycle (%d cycles)\n\n", plan.num_cycles);
+#elif defined(WORK_STEALING)
+    printf("[KERNEL] %s, work stealing (%d-row tiles, %d per SM)\n\n",
+           kernel->name, STEAL_ROWS, TILES_PER_SM);
+#elif defined(PUSH_MODE)
+    printf("[KERNEL] push_scatter (%s, runs of %d ints)\n\n", PUSH_NT_NAME,
 #if defined(GRID_8x8)
-    printf("=== [GRID_8x8] 8 SM parallel execution ===\n\n");
+           STRIP);
+#else
+           TILE);
+#endif
+#elif defined(EXCHANGE_VM)
+    printf("[KERNEL] process_vm_readv gather (private dist, no staging segment)\n\n");
+#else
+    printf("[KERNEL] %s\n\n", kernel->name);
+#endif
     fflush(stdout);
     
     /* Phase 1: dist 생성 */
+#ifdef EXCHANGE_VM
+    printf("[Phase 1] dist 는 각 SM 이 private buffer 에 생성\n\n");
+#else
     for (i = 0; i < NUM_SM; i++) {
         if (fork() == 0) {
-            int dist_buf[512];
-            char fname[32];
-            FILE *fp;
-            
-            make_dist_8x8(i, dist_buf);
-            
-            sprintf(fname, "dist_sm_%d.bin", i);
-            fp = fopen(fname, "wb");
-            fwrite(dist_buf, sizeof(int), 512, fp);
-            fclose(fp);
-            
-            sem_wait_s(semid);
-            memcpy(&shared[i * 512], dist_buf, sizeof(int) * 512);
-            sem_post_s(semid);
-            
+            /* SM 마다 자기 영역에만 쓰므로 lock 불필요 */
+            layout_fill_fields(i, shared);
+#ifdef DUMP_LAYOUT
+            dump_dist(i, &shared[i * LOGICAL_CHUNK]);
+#endif
             exit(0);
         }
     }
     for (i = 0; i < NUM_SM; i++) wait(NULL);
     printf("[Phase 1] dist 생성 완료\n\n");
+#endif
     fflush(stdout);
     
     /* Phase 2 & 3: 재정렬 + 전송 */
@@ -223,13 +4385,24 @@ int main() {
     for (i = 0; i < NUM_SM; i++) {
         if (fork() == 0) {
             int sm = i;
-            int start = sm * SM_CHUNK;
-            int ord_buf[SM_CHUNK];
-            int j, global, row, col, owner_sm, owner_pos;
-            char fname[32];
-            FILE *fp;
-            int msqid;
-            struct msgbuf msg;
+#if defined(REDIST_INPLACE)
+            int *ord_buf = &shared[sm * SM_CHUNK];
+#elif defined(ORD_SEGMENT)
+            int *ord_buf = &ord_shm[sm * SM_CHUNK];
+#elif defined(TRANSPORT_MEMFD)
+            int ord_fd;
+            int *ord_buf = domain_alloc(sizeof(int) * SM_CHUNK * NUM_FIELDS, &ord_fd);
+#elif defined(TRANSPORT_SPLICE)
+            int *ord_buf = domain_alloc_pages(sizeof(int) * SM_CHUNK * NUM_FIELDS);
+#else
+            int *ord_buf = malloc(sizeof(int) * SM_CHUNK * NUM_FIELDS);
+#endif
+            int c;
+            struct chan ch;
+            
+#ifdef EXCHANGE_VM
+            vm_publish(&peers[sm], sm);
+#endif
             
             /* Signal ready */
             sem_wait_s(sem_ready);
@@ -240,19 +4413,24 @@ int main() {
             sem_wait_s(sem_go_cc);
             
             /* Client-Client: 재정렬 */
-            for (j = 0; j < SM_CHUNK; j++) {
-                global = start + j;
-                row = global / N;
-                col = global % N;
-                owner_sm = col / 8;
-                owner_pos = row * 8 + (col % 8);
-                ord_buf[j] = shared[owner_sm * 512 + owner_pos];
-            }
+#if defined(REDIST_INPLACE)
+            run_cycles(shared, &plan, sm);
+#elif defined(WORK_STEALING)
+            ws_run(sm, shared, ord_shm, ws, kernel);
+#elif defined(PUSH_MODE)
+            push_scatter(sm, &shared[sm * LOGICAL_CHUNK], ord_shm);
+#elif defined(EXCHANGE_VM)
+            vm_gather(peers, sm, ord_buf);
             
-            sprintf(fname, "ord_sm_%d.bin", sm);
-            fp = fopen(fname, "wb");
-            fwrite(ord_buf, sizeof(int), SM_CHUNK, fp);
-            fclose(fp);
+            dump_buffer(DUMP_ORD, sm, 0, ord_buf, SM_CHUNK);
+#else
+#ifdef STRAGGLER_US
+            if (sm == 0) usleep(STRAGGLER_US);
+#endif
+            reorder_fields(kernel, shared, ord_buf, sm * (N / 8), (sm + 1) * (N / 8));
+            
+            dump_buffer(DUMP_ORD, sm, 0, ord_buf, SM_CHUNK * NUM_FIELDS);
+#endif
             
             /* Signal done (client-client) */
             sem_wait_s(sem_done_cc);
@@ -262,15 +4440,32 @@ int main() {
             /* Wait for GO (client-server) */
             sem_wait_s(sem_go_cs);
             
-            /* Client-Server: msgsnd */
-            msqid = msgget(MSG_KEY, 0666);
-            msg.mtype = sm + 1;
+#ifdef ORD_SHARED
+            /* 다른 SM 이 내 domain 에 쓰므로 전체 완료 후 저장 */
+            dump_buffer(DUMP_ORD, sm, 0, ord_buf, SM_CHUNK);
+#endif
             
-            memcpy(msg.data, &ord_buf[0], sizeof(int) * CHUNK_INT);
-            msgsnd(msqid, &msg, sizeof(msg.data), 0);
+            /* Client-Server: msgsnd */
+            chan_open(&ch);
             
-            memcpy(msg.data, &ord_buf[CHUNK_INT], sizeof(int) * CHUNK_INT);
-            msgsnd(msqid, &msg, sizeof(msg.data), 0);
+#if defined(TRANSPORT_MEMFD)
+            send_domain(&ch, sm, ord_fd, ord_buf, sizeof(int) * SM_CHUNK * NUM_FIELDS);
+            (void)c;
+#elif defined(TRANSPORT_SPLICE)
+            send_domain_pipe(sm, ord_buf, sizeof(int) * SM_CHUNK * NUM_FIELDS);
+            (void)c;
+#else
+            /* field domain 들이 이어져 있으므로 chunk 번호 c 는 field c / MSGS_PER_SM */
+            for (c = 0; c < BATCH_MSGS; c++)
+                send_chunk(&ch, sm, c, &ord_buf[c * CHUNK_INT]);
+#endif
+            chan_close(&ch);
+#if !defined(ORD_SHARED) && !defined(TRANSPORT_MEMFD) && !defined(TRANSPORT_SPLICE)
+            free(ord_buf);
+#endif
+#ifdef EXCHANGE_VM
+            free(peers[sm].dist);    /* 모든 목적지가 barrier 를 지났으므로 안전 */
+#endif
             
             /* Signal done (client-server) */
             sem_wait_s(sem_done_cs);
@@ -321,20 +4516,38 @@ int main() {
     for (i = 0; i < NUM_SM; i++) wait(NULL);
 
 #elif defined(GRID_4x4)
-    printf("=== [GRID_4x4] 8 logical SM parallel execution ===\n\n");
+    printf("=== [GRID_4x4] 8 logical SM parallel execution (N=%d) ===\n", N);
+#if defined(REDIST_INPLACE)
+    printf("[KERNEL] inplace_cycle (%d cycles)\n\n", plan.num_cycles);
+#elif defined(WORK_STEALING)
+    printf("[KERNEL] %s, work stealing (%d-row tiles, %d per SM)\n\n",
+           kernel->name, STEAL_ROWS, TILES_PER_SM);
+#elif defined(PUSH_MODE)
+    printf("[KERNEL] push_scatter (%s, runs of %d ints)\n\n", PUSH_NT_NAME,
+#if defined(GRID_8x8)
+           STRIP);
+#else
+           TILE);
+#endif
+#elif defined(EXCHANGE_VM)
+    printf("[KERNEL] process_vm_readv gather (private dist, no staging segment)\n\n");
+#else
+    printf("[KERNEL] %s\n\n", kernel->name);
+#endif
     fflush(stdout);
     
     {
-    int initial_shmid, domain_shmid;
-    int *shm_initial, *shm_domain;
+#ifdef DIST_SEGMENT
+    int *shm_initial;
+#endif
     int sem_dist_done, sem_redist_done, sem_go_send;
     union semun sem_arg;
     int l;
     
-    initial_shmid = shmget(IPC_PRIVATE, sizeof(int) * DATA_SIZE, IPC_CREAT | 0666);
-    domain_shmid = shmget(IPC_PRIVATE, sizeof(int) * DATA_SIZE, IPC_CREAT | 0666);
-    shm_initial = shmat(initial_shmid, NULL, 0);
-    shm_domain = shmat(domain_shmid, NULL, 0);
+#ifdef DIST_SEGMENT
+    /* dist 는 main 의 shared segment 에 바로 올린다 (별도 segment 불필요) */
+    shm_initial = shared;
+#endif
     
     sem_dist_done = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
     sem_redist_done = semget(IPC_PRIVATE, 1, IPC_CREAT | 0666);
@@ -350,26 +4563,31 @@ int main() {
     /* 8 logical clients (병렬) */
     for (l = 0; l < LOGICAL_SM; l++) {
         if (fork() == 0) {
-            int dist_buf[512];
-            int ord_buf[512];
-            char fname[32];
-            FILE *fp;
-            int msqid;
-            struct msgbuf msg;
-            int j, target_global, src_sm, src_pos;
-            
-            /* Phase 1: dist 생성 */
-            make_dist_4x4(l, dist_buf);
-            
-            sprintf(fname, "dist_sm_%d.bin", l);
-            fp = fopen(fname, "wb");
-            fwrite(dist_buf, sizeof(int), 512, fp);
-            fclose(fp);
-            
-            /* shared memory에 저장 */
-            sem_wait_s(semid);
-            memcpy(&shm_initial[l * 512], dist_buf, sizeof(int) * 512);
-            sem_post_s(semid);
+#if defined(REDIST_INPLACE)
+            int *ord_buf = &shm_initial[l * LOGICAL_CHUNK];
+#elif defined(ORD_SEGMENT)
+            int *ord_buf = &ord_shm[l * LOGICAL_CHUNK];
+#elif defined(TRANSPORT_MEMFD)
+            int ord_fd;
+            int *ord_buf = domain_alloc(sizeof(int) * LOGICAL_CHUNK * NUM_FIELDS, &ord_fd);
+#elif defined(TRANSPORT_SPLICE)
+            int *ord_buf = domain_alloc_pages(sizeof(int) * LOGICAL_CHUNK * NUM_FIELDS);
+#else
+            int *ord_buf = malloc(sizeof(int) * LOGICAL_CHUNK * NUM_FIELDS);
+#endif
+            struct chan ch;
+            int c;
+            
+#ifdef EXCHANGE_VM
+            /* Phase 1: dist 생성 (private buffer, 주소만 공유) */
+            vm_publish(&peers[l], l);
+#else
+            /* Phase 1: dist 생성 (layout 에서 바로 shared memory 에) */
+            layout_fill_fields(l, shm_initial);
+#ifdef DUMP_LAYOUT
+            dump_dist(l, &shm_initial[l * LOGICAL_CHUNK]);
+#endif
+#endif
             
             /* Signal dist done */
             sem_wait_s(sem_done_cc);
@@ -380,33 +4598,26 @@ int main() {
             sem_wait_s(sem_redist_done);
             
             /* Phase 2: Client-Client 재정렬 (각 client가 자기 domain 데이터 수집) */
-            /* 나의 domain: global index l*512 ~ (l+1)*512 - 1 */
-            for (j = 0; j < 512; j++) {
-                target_global = l * 512 + j;
-                
-                /* 이 global index가 어느 SM의 dist에 있는지 찾기 */
-                /* 4x4 partitioning: 16x16 tile 기반 */
-                {
-                    int row = target_global / N;
-                    int col = target_global % N;
-                    int tile_row = row / 16;
-                    int tile_col = col / 16;
-                    int src_logical_sm = (tile_row % 2) * 4 + tile_col;
-                    int local_row = row % 16;
-                    int local_col = col % 16;
-                    int repeat = tile_row / 2;
-                    src_pos = repeat * 256 + local_row * 16 + local_col;
-                    src_sm = src_logical_sm;
-                }
-                
-                ord_buf[j] = shm_initial[src_sm * 512 + src_pos];
-            }
+            /* 나의 domain: global index l*LOGICAL_CHUNK ~ (l+1)*LOGICAL_CHUNK - 1 */
+#if defined(REDIST_INPLACE)
+            run_cycles(shm_initial, &plan, l);
+#elif defined(WORK_STEALING)
+            ws_run(l, shm_initial, ord_shm, ws, kernel);
+#elif defined(PUSH_MODE)
+            push_scatter(l, &shm_initial[l * LOGICAL_CHUNK], ord_shm);
+#elif defined(EXCHANGE_VM)
+            vm_gather(peers, l, ord_buf);
+            
+            dump_buffer(DUMP_ORD, l, 0, ord_buf, LOGICAL_CHUNK);
+#else
+#ifdef STRAGGLER_US
+            if (l == 0) usleep(STRAGGLER_US);
+#endif
+            reorder_fields(kernel, shm_initial, ord_buf, l * (N / 8), (l + 1) * (N / 8));
             
             /* Save ord file */
-            sprintf(fname, "ord_sm_%d.bin", l);
-            fp = fopen(fname, "wb");
-            fwrite(ord_buf, sizeof(int), 512, fp);
-            fclose(fp);
+            dump_buffer(DUMP_ORD, l, 0, ord_buf, LOGICAL_CHUNK * NUM_FIELDS);
+#endif
             
             /* Signal redistribution done */
             sem_wait_s(sem_done_cs);
@@ -416,15 +4627,30 @@ int main() {
             /* Wait for GO to send */
             sem_wait_s(sem_go_send);
             
-            /* Phase 3: Client-Server 전송 */
-            msqid = msgget(MSG_KEY, 0666);
-            msg.mtype = l + 1;
+#ifdef ORD_SHARED
+            dump_buffer(DUMP_ORD, l, 0, ord_buf, LOGICAL_CHUNK);
+#endif
             
-            memcpy(msg.data, &ord_buf[0], sizeof(int) * CHUNK_INT);
-            msgsnd(msqid, &msg, sizeof(msg.data), 0);
+            /* Phase 3: Client-Server 전송 */
+            chan_open(&ch);
             
-            memcpy(msg.data, &ord_buf[CHUNK_INT], sizeof(int) * CHUNK_INT);
-            msgsnd(msqid, &msg, sizeof(msg.data), 0);
+#if defined(TRANSPORT_MEMFD)
+            send_domain(&ch, l, ord_fd, ord_buf, sizeof(int) * LOGICAL_CHUNK * NUM_FIELDS);
+            (void)c;
+#elif defined(TRANSPORT_SPLICE)
+            send_domain_pipe(l, ord_buf, sizeof(int) * LOGICAL_CHUNK * NUM_FIELDS);
+            (void)c;
+#else
+            for (c = 0; c < BATCH_MSGS; c++)
+                send_chunk(&ch, l, c, &ord_buf[c * CHUNK_INT]);
+#endif
+            chan_close(&ch);
+#if !defined(ORD_SHARED) && !defined(TRANSPORT_MEMFD) && !defined(TRANSPORT_SPLICE)
+            free(ord_buf);
+#endif
+#ifdef EXCHANGE_VM
+            free(peers[l].dist);    /* 모든 목적지가 barrier 를 지났으므로 안전 */
+#endif
             
             /* Signal send done */
             sem_wait_s(sem_ready);
@@ -476,36 +4702,257 @@ int main() {
     
     for (i = 0; i < LOGICAL_SM; i++) wait(NULL);
     
-    shmdt(shm_initial);
-    shmdt(shm_domain);
-    shmctl(initial_shmid, IPC_RMID, NULL);
-    shmctl(domain_shmid, IPC_RMID, NULL);
     semctl(sem_dist_done, 0, IPC_RMID);
     semctl(sem_redist_done, 0, IPC_RMID);
     semctl(sem_go_send, 0, IPC_RMID);
     }
 #endif
     
-    /* Wait for server */
-    wait(NULL);
+    dump_finish();
+    
+    /* Wait for servers */
+    for (i = 0; i < NUM_SERVERS; i++) wait(NULL);
+    
+    /* server 별 결과 병합: 시간은 병렬이므로 최대, byte 와 encode 시간은 합 */
+    memset(srv, 0, sizeof(srv));
+    for (i = 0; i < NUM_SERVERS; i++) {
+        double *st = &server_times[i * ST_COUNT];
+        for (hop = 0; hop < ST_COUNT; hop++) {
+            if (hop == ST_RECV || hop == ST_IO)
+                srv[hop] = st[hop] > srv[hop] ? st[hop] : srv[hop];
+            else
+                srv[hop] += st[hop];
+        }
+    }
+    
+    getrusage(RUSAGE_SELF, &ru_self);
+    getrusage(RUSAGE_CHILDREN, &ru_child);
     
     /* Print results */
     printf("\n========== TIMING RESULTS ==========\n");
+#if defined(EXCHANGE_VM)
+    printf("[CLIENT-CLIENT] %.6f sec (process_vm_readv 재정렬, 병렬)\n", 
+           GET_DURATION(total_cc_s, total_cc_e));
+#elif defined(COLLECTIVE)
+    printf("[CLIENT-CLIENT] %.6f sec (%s, 병렬)\n", 
+           GET_DURATION(total_cc_s, total_cc_e), COLL_NAME);
+#else
     printf("[CLIENT-CLIENT] %.6f sec (shared memory 재정렬, 병렬)\n", 
            GET_DURATION(total_cc_s, total_cc_e));
-    printf("[CLIENT-SERVER] %.6f sec (msgsnd 완료까지, 병렬)\n", 
+#endif
+    printf("[CLIENT-SERVER] %.6f sec (전송 완료까지, 병렬)\n", 
            GET_DURATION(total_cs_s, total_cs_e));
-    printf("[SERVER RECV]   %.6f sec (msgrcv 누적)\n", server_times[0]);
-    printf("[SERVER I/O]    %.6f sec (fwrite 누적)\n", server_times[1]);
+    printf("[SERVER RECV]   %.6f sec (수신 누적)\n", srv[ST_RECV]);
+    printf("[SERVER I/O]    %.6f sec (disk 기록 누적)\n", srv[ST_IO]);
+    printf("[SERVER CPU]    %.6f sec (user+sys), %.3f ns/byte, %.3f sec/GB\n", srv[ST_CPU],
+           srv[ST_RAW_BYTES] > 0 ? srv[ST_CPU] * 1e9 / srv[ST_RAW_BYTES] : 0.0,
+           srv[ST_RAW_BYTES] > 0 ? srv[ST_CPU] / (srv[ST_RAW_BYTES] / 1e9) : 0.0);
+#if NUM_SERVERS > 1
+    for (i = 0; i < NUM_SERVERS; i++)
+        printf("[SERVER %d]      recv %.6f, I/O %.6f sec, %.0f bytes\n", i,
+               server_times[i * ST_COUNT + ST_RECV], server_times[i * ST_COUNT + ST_IO],
+               server_times[i * ST_COUNT + ST_DISK_BYTES]);
+#endif
+#ifdef DISK_EMU
+    /* 사용률: disk 가 바빴던 시간 / 그 disk 를 맡은 server 의 job 시간 (수신 + 기록) */
+    for (i = 0; i < 4; i++) {
+        double *st = &server_times[(i % NUM_SERVERS) * ST_COUNT];
+        double span = st[ST_RECV] + st[ST_IO];
+        printf("[DISK %d]        %s%.2f MB/s cap, %.0f writes, %.2f MB/s, busy %.6f sec "
+               "(util %.1f%%), throttle %.6f sec, avg %.1f / max %.1f us/write, %.0f stalls\n",
+               i, i == DISK_SLOW ? "slow, " : "",
+               DISK_MBPS / (double)(i == DISK_SLOW ? DISK_SLOW_FACTOR : 1),
+               srv[ST_EMU_WRITES + i],
+               span > 0 ? srv[ST_EMU_BYTES + i] / 1048576.0 / span : 0.0,
+               srv[ST_EMU_BUSY + i], span > 0 ? 100.0 * srv[ST_EMU_BUSY + i] / span : 0.0,
+               srv[ST_EMU_WAIT + i],
+               srv[ST_EMU_WRITES + i] > 0 ? srv[ST_EMU_BUSY + i] * 1e6 / srv[ST_EMU_WRITES + i]
+                                          : 0.0,
+               srv[ST_EMU_MAXLAT + i] * 1e6, srv[ST_EMU_STALLS + i]);
+    }
+#endif
+#ifdef STORAGE_LOG
+    printf("[STORAGE]       log append %.0f groups (%d byte group), checkpoint %.6f sec, "
+           "background compaction -> RAID0 %.6f sec (%.2f MB/s), server waited %.6f sec\n",
+           srv[ST_LOG_GROUPS], LOG_GROUP, srv[ST_CKPT], srv[ST_COMPACT],
+           srv[ST_COMPACT] > 0 ? srv[ST_RAW_BYTES] / 1048576.0 / srv[ST_COMPACT] : 0.0,
+           srv[ST_COMPACT_WAIT]);
+#endif
+#if defined(TRANSPORT_UNIX)
+    printf("[TRANSPORT]     unix socket, batch %d, sockbuf %d\n", SEND_BATCH, SOCK_BUF);
+#elif defined(TRANSPORT_SPLICE)
+    printf("[TRANSPORT]     vmsplice -> pipe -> splice (disk 당 pipe 하나, server user space 복사 0)\n");
+#elif defined(TRANSPORT_MEMFD)
+    printf("[TRANSPORT]     memfd + SCM_RIGHTS (SM domain 당 sealed fd 하나, payload 복사 0)\n");
+#elif defined(TRANSPORT_TCP)
+    printf("[TRANSPORT]     tcp loopback, batch %d, sockbuf %d, nodelay %d\n",
+           SEND_BATCH, SOCK_BUF, SOCK_NODELAY);
+#else
+    printf("[TRANSPORT]     sysv msg queue\n");
+#endif
+#ifdef COLLECTIVE
+    /* busbw: ring 기준 SM 당 실제 이동량 (allreduce 2(n-1)/n, 나머지 (n-1)/n) */
+    coll_bw = sizeof(coll_t) * (double)COLL_ELEMS / GET_DURATION(total_cc_s, total_cc_e) / 1e9;
+    printf("[COLLECTIVE]    %s %s, %.2f GB/s algbw, %.2f GB/s busbw, verify %s (%ld bad)\n",
+#if defined(COLL_ALLGATHER)
+           COLL_NAME, COLL_TYPE_NAME, coll_bw,
+#else
+           COLL_NAME, rk->name, coll_bw,
+#endif
+#if defined(COLL_ALLREDUCE)
+           coll_bw * 2 * (LOGICAL_SM - 1) / LOGICAL_SM,
+#else
+           coll_bw * (LOGICAL_SM - 1) / LOGICAL_SM,
+#endif
+           coll_bad ? "FAIL" : "OK", coll_bad);
+#endif
+#ifdef EXCHANGE_VM
+    vm_calls = vm_iovs = 0;
+    vm_bytes = 0;
+    for (i = 0; i < LOGICAL_SM; i++) {
+        vm_calls += peers[i].calls;
+        vm_iovs += peers[i].iovs;
+        vm_bytes += peers[i].bytes;
+    }
+    printf("[EXCHANGE]      process_vm_readv %ld calls, %ld iovecs, %lld bytes (%.2f GB/s), "
+           "staging segment %zu bytes 생략\n", vm_calls, vm_iovs, vm_bytes,
+           vm_bytes / GET_DURATION(total_cc_s, total_cc_e) / 1e9, sizeof(int) * DATA_SIZE);
+#endif
+#if NUM_FIELDS > 1
+    /* fork / barrier / 연결은 batch 당 한 번이므로 field 하나 몫은 전체의 1/K */
+    printf("[FIELDS]        %d fields x %zu bytes, 한 batch (barrier 4, SM 당 %d msg), "
+           "field 당 %.6f sec\n", NUM_FIELDS, sizeof(int) * (size_t)DATA_SIZE, BATCH_MSGS,
+           (GET_DURATION(total_cc_s, total_cc_e) + GET_DURATION(total_cs_s, total_cs_e)) /
+           NUM_FIELDS);
+#endif
+#ifdef RAID_COMPRESS
+    dec_time = 0;
+    dec_bad = 0;
+#ifdef NUM_TENANTS
+    raw_bytes = 0;
+    for (i = 0; i < NUM_TENANTS; i++) {
+        char dir[32];
+        sprintf(dir, "job_%d", i);
+        raw_bytes += raid_read_back(dir, &dec_time, &dec_bad);
+    }
+#else
+    raw_bytes = raid_read_back(".", &dec_time, &dec_bad);
+#endif
+    printf("[RAID COMPRESS] %.0f -> %.0f bytes (%.1f%%), encode %.2f GB/s, decode %.2f GB/s%s\n",
+           srv[ST_RAW_BYTES], srv[ST_DISK_BYTES],
+           100.0 * srv[ST_DISK_BYTES] / srv[ST_RAW_BYTES],
+           srv[ST_ENCODE] > 0 ? srv[ST_RAW_BYTES] / srv[ST_ENCODE] / 1e9 : 0.0,
+           dec_time > 0 ? raw_bytes / dec_time / 1e9 : 0.0,
+           dec_bad ? " MISMATCH" : "");
+#endif
+    for (i = 0; i < LOGICAL_SM; i++) {
+        static const char *hop_name[HOP_COUNT] = { "queue", "write", "e2e" };
+        printf("[LAT SM %d]     ", i);
+        for (hop = 0; hop < HOP_COUNT; hop++)
+            printf("%s p50 %.1f p99 %.1f p999 %.1f us%s", hop_name[hop],
+                   hist_percentile(&hist[i][hop], 0.50) / 1000.0,
+                   hist_percentile(&hist[i][hop], 0.99) / 1000.0,
+                   hist_percentile(&hist[i][hop], 0.999) / 1000.0,
+                   hop + 1 < HOP_COUNT ? " | " : "\n");
+    }
+    printf("[THROUGHPUT]    %.2f MB/s (재정렬 + 전송, 원소 %d byte)\n",
+           sizeof(int) * (double)DATA_SIZE * NUM_FIELDS / 1048576.0 /
+           (GET_DURATION(total_cc_s, total_cc_e) + GET_DURATION(total_cs_s, total_cs_e)),
+           ELEM_SIZE);
+#ifdef DAEMON_MODE
+    printf("[COLD START]    %.6f sec (IPC 생성 + fork + Phase 1 %.6f, 첫 job %.6f)\n",
+           GET_DURATION(cold_s, cold_e) + first_job,
+           GET_DURATION(cold_s, cold_e), first_job);
+    printf("[WARM JOB]      avg %.6f, min %.6f, max %.6f sec (%d jobs)\n",
+           NUM_JOBS > 1 ? warm_sum / (NUM_JOBS - 1) : 0.0, warm_min, warm_max,
+           NUM_JOBS - 1);
+#endif
+#ifdef INCREMENTAL
+    printf("[INCREMENTAL]   frame 0 재정렬 %lld / 전송 %lld bytes, 이후 frame 평균 재정렬 %.0f / "
+           "전송 %.0f bytes (%.1f%%), dirty tile %.1f/%d, RAID verify %s (%ld bad)\n",
+           incr->first_gathered, incr->first_sent,
+           NUM_JOBS > 1 ? (double)incr->sum_gathered / (NUM_JOBS - 1) : 0.0,
+           NUM_JOBS > 1 ? (double)incr->sum_sent / (NUM_JOBS - 1) : 0.0,
+           NUM_JOBS > 1 ? 100.0 * incr->sum_sent / (NUM_JOBS - 1) /
+                          (sizeof(int) * (double)DATA_SIZE) : 0.0,
+           NUM_JOBS > 1 ? (double)incr->sum_tiles / (NUM_JOBS - 1) : 0.0, DIRTY_TILES,
+           incr_bad ? "FAIL" : "OK", incr_bad);
+    shmdt(incr);
+    shmctl(incr_shmid, IPC_RMID, NULL);
+#endif
+#ifdef NUM_TENANTS
+    tput_sum = tput_sq = 0;
+    for (i = 0; i < NUM_TENANTS; i++) {
+        tput = ts->bytes[i] / 1048576.0 / ((ts->done_ns[i] - ts->first_ns[i]) / 1e9);
+        printf("[TENANT %d]      %d pass, %.0f bytes, %.2f MB/s, 완료 %.6f sec (첫 chunk 부터)\n",
+               i, TENANT_PASSES(i), ts->bytes[i], tput,
+               (ts->done_ns[i] - ts->first_ns[i]) / 1e9);
+        tput_sum += ts->shared_bytes[i];
+        tput_sq += ts->shared_bytes[i] * ts->shared_bytes[i];
+    }
+    /* Jain index: 모든 job 이 경쟁하는 구간에서 받은 byte 의 고른 정도 (1 = 완전 공평) */
+    printf("[FAIRNESS]      Jain %.3f (경쟁 구간 byte), %ld DRR rounds\n",
+           tput_sq > 0 ? tput_sum * tput_sum / (NUM_TENANTS * tput_sq) : 1.0, ts->rounds);
+#endif
+#ifdef WORK_STEALING
+    for (i = 0; i < LOGICAL_SM; i++)
+        printf("[SM %d]          tiles %ld, steals %ld, busy %.6f sec\n",
+               i, ws->tiles[i], ws->steals[i], ws->busy[i]);
+#endif
+#ifdef REDIST_INPLACE
+    max_moved = 0;
+    for (i = 0; i < LOGICAL_SM; i++)
+        if (plan.moved[i] > max_moved) max_moved = plan.moved[i];
+    printf("[INPLACE PLAN]  %.6f sec (cycle leader 계산, SM 당 최대 %ld 원소 이동)\n",
+           GET_DURATION(plan_s, plan_e), max_moved);
+#endif
+#ifdef REDIST_PLAN
+    printf("[REDIST PLAN]   %.6f sec (계획 생성: %s -> %s, %d runs, %d SM 쌍, 실행은 CLIENT-CLIENT)\n",
+           GET_DURATION(plan_s, plan_e), redist_active.src.name, redist_active.dst.name,
+           redist_active.first[LOGICAL_SM], redist_active.pairs);
+#endif
+    dump_report();
+    printf("[PEAK MEM]      shm %.2f MB, max RSS %.2f MB (child), %.2f MB (parent)\n",
+           shm_bytes / 1048576.0, ru_child.ru_maxrss / 1024.0,
+           ru_self.ru_maxrss / 1024.0);
     
     /* Cleanup */
+#ifdef REDIST_PLAN
+    redist_plan_free(&redist_active);
+#endif
+#ifdef DIST_SEGMENT
     shmdt(shared);
+#endif
+#ifdef EXCHANGE_VM
+    shmdt(peers);
+    shmctl(peer_shmid, IPC_RMID, NULL);
+#endif
     shmdt(server_times);
+    shmdt(hist);
     shmdt(counters);
+#ifdef DIST_SEGMENT
     shmctl(shmid, IPC_RMID, NULL);
+#endif
     shmctl(server_time_shmid, IPC_RMID, NULL);
+#ifdef TRANSPORT_SPLICE
+    splice_cleanup();
+#endif
+#ifdef NUM_TENANTS
+    for (i = 0; i < NUM_TENANTS; i++) msgctl(tenant_q[i], IPC_RMID, NULL);
+    shmdt(ts);
+    shmctl(tenant_shmid, IPC_RMID, NULL);
+    semctl(sem_tenant, 0, IPC_RMID);
+#endif
+    shmctl(hist_shmid, IPC_RMID, NULL);
     shmctl(counter_shmid, IPC_RMID, NULL);
-    semctl(semid, 0, IPC_RMID);
+#ifdef ORD_SEGMENT
+    shmdt(ord_shm);
+    shmctl(ord_shmid, IPC_RMID, NULL);
+#endif
+#ifdef WORK_STEALING
+    shmdt(ws);
+    shmctl(ws_shmid, IPC_RMID, NULL);
+#endif
     semctl(sem_ready, 0, IPC_RMID);
     semctl(sem_go_cc, 0, IPC_RMID);
     semctl(sem_done_cc, 0, IPC_RMID);
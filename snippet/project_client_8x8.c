@@ -16,7 +16,9 @@
 // server에 msgsnd 보내는 부분 추가
 #include <sys/msg.h>
 
+#ifndef MSG_KEY
 #define MSG_KEY 0x1234
+#endif
 #define CHUNK_INT 256
 
 struct msgbuf {
@@ -26,7 +26,9 @@
 #define SEM_DOMAIN_READY_NAME "/sem_domain_ready_sm"
 #define SEM_C2S_READY_NAME    "/sem_c2s_ready_sm"
 
+#ifndef MSG_KEY
 #define MSG_KEY 0x1234
+#endif
 #define CHUNK_INT 256
 
 struct msgbuf {
@@ -6,7 +6,9 @@
 #include <sys/time.h>
 #include <unistd.h>
 
+#ifndef MSG_KEY
 #define MSG_KEY 0x1234
+#endif
 #define NUM_CLIENT 8
 #define NUM_DISK 4
 #define CHUNK_INT 256
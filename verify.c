@@ -0,0 +1,476 @@
+/*
+ * project_final 실행 결과 검증 도구.
+ *   gcc -O2 -mavx2 -DN=... [mode flags] verify.c -o verify -lpthread
+ *   ./verify [dir]          (종료 코드: 0 OK, 1 FAIL, 2 지원하지 않는 출력)
+ * payload 가 index 이므로 모든 위치의 기대값을 layout 식으로 알 수 있다.
+ *   ord_sm_%d.bin  : field 마다 목적 layout (REDIST_DST, 기본 row block) 의 SM l 영역
+ *   raid_disk%d.bin: CHUNK_INT 단위 block 이 ord 영역의 한 조각이고, disk d 의 SM
+ *                    (sm % 4 == d) chunk 가 순서와 무관하게 정확히 한 번씩 (압축 disk 는 건너뜀)
+ * 파일은 mmap 하고 VERIFY_BLOCK word 단위 작업을 VERIFY_THREADS 개 thread 가 나눠
+ * SIMD 로 비교한다. 파일마다 처음 어긋난 위치를 보고.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/* ===================== MODE ===================== */
+/*
+ * project_final 과 같은 -DN / -DELEM_SIZE / -DNUM_FIELDS 와 출력 모양을 바꾸는 flag 로 빌드:
+ *   -DREDIST_DST=LAYOUT_... : ord 영역이 그 layout
+ *   -DINCREMENTAL           : payload 는 index + frame * DATA_SIZE (DIRTY_TILE 조각마다 frame),
+ *                             RAID 는 고정 stripe 위치 (SM sm, sm + 4 순)
+ *   -DNUM_TENANTS=J         : dir/job_%d 마다 RAID, job 0 은 chunk 가 TENANT_BIG 번씩
+ *   -DCOLL_*                : payload 가 index 가 아니므로 지원하지 않음 (project_final 이 직접 검증)
+ */
+#define LOGICAL_SM 8
+#ifndef N
+#define N 64
+#endif
+#ifndef ELEM_SIZE
+#define ELEM_SIZE 4
+#endif
+#ifndef NUM_FIELDS
+#define NUM_FIELDS 1
+#endif
+#define ELEM_WORDS (ELEM_SIZE / 4)
+#define DATA_SIZE (N * N * ELEM_WORDS)
+#define LOGICAL_CHUNK (DATA_SIZE / LOGICAL_SM)
+#define CHUNK_INT 256
+#define MSGS_PER_SM (LOGICAL_CHUNK / CHUNK_INT)
+#define TOTAL_CHUNKS (NUM_FIELDS * LOGICAL_SM * MSGS_PER_SM)
+#define ROW_WORDS (N * ELEM_WORDS)
+
+#if defined(COLL_ALLGATHER) || defined(COLL_REDUCE_SCATTER) || defined(COLL_ALLREDUCE)
+#define COLLECTIVE
+#endif
+#ifdef INCREMENTAL
+#ifndef DIRTY_TILE
+#define DIRTY_TILE 16
+#endif
+#if NUM_FIELDS > 1 || defined(REDIST_DST) || N % (8 * DIRTY_TILE) != 0
+#error "INCREMENTAL outputs are single-field row blocks (DIRTY_TILE must divide N/8)"
+#endif
+#endif
+#ifdef NUM_TENANTS
+#ifndef TENANT_BIG
+#define TENANT_BIG 8
+#endif
+#define TENANT_PASSES(j) ((j) == 0 ? TENANT_BIG : 1)
+#else
+#define NUM_TENANTS 1
+#define TENANT_PASSES(j) 1
+#endif
+#ifndef REDIST_DST
+#define REDIST_DST LAYOUT_ROWS
+#endif
+
+#ifndef VERIFY_THREADS
+#define VERIFY_THREADS 4
+#endif
+#define VERIFY_BLOCK (1 << 18)      /* 작업 하나의 word 수 (CHUNK_INT 의 배수) */
+#define MAX_FILES (LOGICAL_SM + 4)
+
+#if N % 8 != 0 || LOGICAL_CHUNK % CHUNK_INT != 0 || ELEM_SIZE % 4 != 0
+#error "N, ELEM_SIZE must match a valid project_final build"
+#endif
+
+#if defined(__AVX2__)
+#define VERIFY_ISA "avx2"
+#elif defined(__SSE2__)
+#define VERIFY_ISA "sse2"
+#else
+#define VERIFY_ISA "scalar"
+#endif
+
+/* ===================== TIME ===================== */
+#define GET_DURATION(s,e) \
+ ((e.tv_sec - s.tv_sec) + (e.tv_usec - s.tv_usec)/1000000.0)
+
+/* ===================== LAYOUT ===================== */
+/* project_final 의 dist_layout 과 같은 정의 (2D block-cyclic) */
+struct dist_layout {
+    const char *name;
+    int bh, bw;         /* block 크기 (행, word) */
+    int pr, pc;         /* SM grid, pr * pc == LOGICAL_SM */
+};
+
+#define LAYOUT_ROWS             { "rows", N / 8, ROW_WORDS, 8, 1 }
+#define LAYOUT_COLS             { "cols", N, ROW_WORDS / 8, 1, 8 }
+#define LAYOUT_TILES            { "tiles", N / 4, ROW_WORDS / 4, 2, 4 }
+#define LAYOUT_ROW_CYCLIC(b)    { "row-cyclic " #b, (b), ROW_WORDS, 8, 1 }
+#define LAYOUT_BLOCK_CYCLIC(b)  { "block-cyclic " #b, (b), (b) * ELEM_WORDS, 2, 4 }
+
+static const struct dist_layout dst_layout = REDIST_DST;
+
+#ifndef INCREMENTAL
+/* global word g 의 (SM, 영역 안 위치) */
+static void layout_locate(int g, int *sm, int *local) {
+    const struct dist_layout *L = &dst_layout;
+    int r = g / ROW_WORDS, c = g % ROW_WORDS;
+    int br = r / L->bh, bc = c / L->bw;
+    int lb = (br / L->pr) * (ROW_WORDS / L->bw / L->pc) + bc / L->pc;
+
+    *sm = (br % L->pr) * L->pc + bc % L->pc;
+    *local = lb * L->bh * L->bw + (r % L->bh) * L->bw + c % L->bw;
+}
+#endif
+
+/* 역방향: SM sm 영역의 local 위치에 오는 global word. *len 은 거기서부터 연속인 길이 */
+static int layout_global(int sm, int local, int *len) {
+    const struct dist_layout *L = &dst_layout;
+    int nbc = ROW_WORDS / L->bw / L->pc;
+    int lb = local / (L->bh * L->bw), in = local % (L->bh * L->bw);
+    int br = (lb / nbc) * L->pr + sm / L->pc, bc = (lb % nbc) * L->pc + sm % L->pc;
+
+    *len = L->bw - in % L->bw;
+    if (L->bw == ROW_WORDS) *len = L->bh * L->bw - in;      /* 전체 행 block 은 통째로 연속 */
+    return (br * L->bh + in / L->bw) * ROW_WORDS + bc * L->bw + in % L->bw;
+}
+
+/* ===================== COMPARE ===================== */
+/* p[i] == first + i 가 처음 깨지는 i (끝까지 맞으면 n) */
+static long iota_mismatch(const int *p, long n, int first) {
+    long i = 0;
+#if defined(__AVX2__)
+    __m256i want = _mm256_add_epi32(_mm256_set1_epi32(first),
+                                    _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256i step = _mm256_set1_epi32(8);
+
+    for (; i + 8 <= n; i += 8) {
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(
+                _mm256_loadu_si256((const __m256i *)&p[i]), want)) != -1)
+            break;
+        want = _mm256_add_epi32(want, step);
+    }
+#elif defined(__SSE2__)
+    __m128i want = _mm_add_epi32(_mm_set1_epi32(first), _mm_setr_epi32(0, 1, 2, 3));
+    const __m128i step = _mm_set1_epi32(4);
+
+    for (; i + 4 <= n; i += 4) {
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(
+                _mm_loadu_si128((const __m128i *)&p[i]), want)) != 0xffff)
+            break;
+        want = _mm_add_epi32(want, step);
+    }
+#endif
+    for (; i < n; i++)
+        if (p[i] != first + (int)i) return i;
+    return n;
+}
+
+/*
+ * p[i] 가 first + i 인지 (INCREMENTAL 이면 DIRTY_TILE 조각마다 frame * DATA_SIZE 만큼
+ * 더해져도 된다). 처음 어긋난 i 와 그 기대값, 끝까지 맞으면 n
+ */
+static long run_mismatch(const int *p, long n, int first, int *want) {
+#ifdef INCREMENTAL
+    long i = 0, len, bad;
+    int d;
+
+    while (i < n) {
+        len = DIRTY_TILE - (first + i) % DIRTY_TILE;
+        if (len > n - i) len = n - i;
+        d = p[i] - (first + (int)i);
+        if (d < 0 || d % DATA_SIZE != 0) d = 0;        /* frame 이 아니면 frame 0 으로 보고 */
+        bad = iota_mismatch(&p[i], len, first + (int)i + d);
+        if (bad < len) { *want = first + (int)(i + bad) + d; return i + bad; }
+        i += len;
+    }
+    return n;
+#else
+    long bad = iota_mismatch(p, n, first);
+
+    *want = first + (int)bad;
+    return bad;
+#endif
+}
+
+/* SM sm 의 ord stream (field 영역을 이은 것) pos 부터 n word 를 대조 */
+static long domain_mismatch(const int *p, long n, int sm, long pos, int *want) {
+    long i = 0, len, bad;
+    int local, run, first;
+
+    while (i < n) {
+        local = (int)((pos + i) % LOGICAL_CHUNK);
+        first = (int)((pos + i) / LOGICAL_CHUNK) * DATA_SIZE + layout_global(sm, local, &run);
+        len = run;
+        if (len > n - i) len = n - i;
+        bad = run_mismatch(&p[i], len, first, want);
+        if (bad < len) return i + bad;
+        i += len;
+    }
+    return n;
+}
+
+/* ===================== FILES ===================== */
+enum { FILE_ORD, FILE_RAID };
+
+struct vfile {
+    char name[320];
+    int kind;
+    int id;                 /* ord: logical SM, raid: disk */
+    const int *p;
+    long words;
+    long first_bad;         /* 처음 어긋난 word (없으면 -1) */
+    int got, want;
+};
+
+struct vjob {
+    int file;
+    long begin, end;        /* word 범위 */
+};
+
+static struct vfile files[MAX_FILES];
+static int num_files;
+static struct vjob *jobs;
+static int num_jobs;
+static int next_job;
+static unsigned char seen[TOTAL_CHUNKS];    /* RAID chunk 별 등장 횟수 */
+static int passes;                          /* chunk 마다 기대 등장 횟수 */
+static pthread_mutex_t bad_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 더 앞의 mismatch 만 남긴다 */
+static void report_bad(struct vfile *f, long pos, int want) {
+    pthread_mutex_lock(&bad_lock);
+    if (f->first_bad < 0 || pos < f->first_bad) {
+        f->first_bad = pos;
+        f->got = f->p[pos];
+        f->want = want;
+    }
+    pthread_mutex_unlock(&bad_lock);
+}
+
+/* ord 파일 word j: SM l 의 ord stream 위치 j */
+static void verify_ord(struct vfile *f, long begin, long end) {
+    long bad;
+    int want;
+
+    bad = domain_mismatch(&f->p[begin], end - begin, f->id, begin, &want);
+    if (bad < end - begin) report_bad(f, begin + bad, want);
+}
+
+#ifdef INCREMENTAL
+/* RAID disk d 는 고정 stripe 위치: word j 는 SM d + 4 * (j / LOGICAL_CHUNK) 의 j % LOGICAL_CHUNK */
+static void verify_raid(struct vfile *f, long begin, long end) {
+    long j, len, bad;
+    int want;
+
+    for (j = begin; j < end; j += len) {
+        len = LOGICAL_CHUNK - j % LOGICAL_CHUNK;
+        if (len > end - j) len = end - j;
+        bad = domain_mismatch(&f->p[j], len, f->id + 4 * (int)(j / LOGICAL_CHUNK),
+                              j % LOGICAL_CHUNK, &want);
+        if (bad < len) { report_bad(f, j + bad, want); return; }
+    }
+}
+#else
+/* RAID disk: chunk 첫 값으로 (field, SM, 위치) 를 찾아 이 disk 몫인지, 내용이 그 조각인지 확인 */
+static void verify_raid(struct vfile *f, long begin, long end) {
+    long j, bad;
+    int first, field, sm, local, want;
+
+    for (j = begin; j < end; j += CHUNK_INT) {
+        first = f->p[j];
+        field = first / DATA_SIZE;
+        if (first < 0 || field >= NUM_FIELDS) { report_bad(f, j, -1); continue; }
+        layout_locate(first % DATA_SIZE, &sm, &local);
+        if (local % CHUNK_INT != 0 || sm % 4 != f->id) { report_bad(f, j, -1); continue; }
+        bad = domain_mismatch(&f->p[j], CHUNK_INT, sm, (long)field * LOGICAL_CHUNK + local, &want);
+        if (bad < CHUNK_INT) { report_bad(f, j + bad, want); continue; }
+        __atomic_fetch_add(&seen[(field * LOGICAL_SM + sm) * MSGS_PER_SM + local / CHUNK_INT], 1,
+                           __ATOMIC_RELAXED);
+    }
+}
+#endif
+
+static void *verify_worker(void *arg) {
+    struct vjob *jb;
+    int k;
+
+    (void)arg;
+    while ((k = __atomic_fetch_add(&next_job, 1, __ATOMIC_RELAXED)) < num_jobs) {
+        jb = &jobs[k];
+        if (files[jb->file].kind == FILE_ORD)
+            verify_ord(&files[jb->file], jb->begin, jb->end);
+        else
+            verify_raid(&files[jb->file], jb->begin, jb->end);
+    }
+    return NULL;
+}
+
+/* 있으면 map 해서 목록에 넣는다 */
+static int add_file(const char *dir, const char *fmt, int kind, int id) {
+    struct vfile *f = &files[num_files];
+    struct stat st;
+    void *p;
+    int fd;
+
+    snprintf(f->name, sizeof(f->name), "%s/", dir);
+    snprintf(f->name + strlen(f->name), sizeof(f->name) - strlen(f->name), fmt, id);
+    fd = open(f->name, O_RDONLY);
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) < 0) { perror("fstat"); exit(1); }
+    p = NULL;
+    if (st.st_size > 0) {
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) { perror("mmap"); exit(1); }
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    f->kind = kind;
+    f->id = id;
+    f->p = p;
+    f->words = st.st_size / sizeof(int);
+    f->first_bad = -1;
+    num_files++;
+    return 1;
+}
+
+/* ===================== MAIN ===================== */
+/* .idx 가 .bin 이후에 쓰였으면 (RAID_COMPRESS 실행의 짝) 압축 disk */
+static int compressed_disk(const char *dir, int disk) {
+    struct stat si, sb;
+    char fn[320];
+
+    snprintf(fn, sizeof(fn), "%s/raid_disk%d.idx", dir, disk);
+    if (stat(fn, &si) < 0) return 0;
+    snprintf(fn, sizeof(fn), "%s/raid_disk%d.bin", dir, disk);
+    if (stat(fn, &sb) < 0) return 0;
+    if (si.st_mtim.tv_sec != sb.st_mtim.tv_sec) return si.st_mtim.tv_sec > sb.st_mtim.tv_sec;
+    return si.st_mtim.tv_nsec >= sb.st_mtim.tv_nsec;
+}
+
+/* dir 하나를 검증, 실패면 1 */
+static int verify_dir(const char *dir) {
+    pthread_t th[VERIFY_THREADS];
+    struct timeval s, e;
+    long want_words, bytes = 0;
+    int i, fail = 0, raid_files = 0, skipped = 0;
+    long j;
+
+    num_files = num_jobs = next_job = 0;
+    memset(seen, 0, sizeof(seen));
+    if (NUM_TENANTS == 1)
+        for (i = 0; i < LOGICAL_SM; i++) add_file(dir, "ord_sm_%d.bin", FILE_ORD, i);
+    for (i = 0; i < 4; i++) {
+        if (compressed_disk(dir, i)) {
+            printf("[VERIFY]        %s/raid_disk%d.bin 압축 disk, 건너뜀 (RAID_COMPRESS read-back 사용)\n",
+                   dir, i);
+            skipped++;
+            continue;
+        }
+        raid_files += add_file(dir, "raid_disk%d.bin", FILE_RAID, i);
+    }
+    if (skipped == 4)
+        printf("[VERIFY]        경고: RAID disk 4 개 모두 건너뜀, RAID 는 검증되지 않음\n");
+    if (num_files == 0) {
+        fprintf(stderr, "no ord_sm_*.bin / raid_disk*.bin in %s\n", dir);
+        return 1;
+    }
+
+    /* 크기 확인 후 VERIFY_BLOCK 단위 작업으로 나눈다 */
+    jobs = malloc(sizeof(struct vjob) * (num_files * (passes * 2L * DATA_SIZE * NUM_FIELDS /
+                                                    VERIFY_BLOCK + 2)));
+    for (i = 0; i < num_files; i++) {
+        want_words = files[i].kind == FILE_ORD ? (long)LOGICAL_CHUNK * NUM_FIELDS
+                                               : 2L * LOGICAL_CHUNK * NUM_FIELDS * passes;
+        if (files[i].words != want_words) {
+            printf("[VERIFY]        %s 크기 %ld words, 기대 %ld\n", files[i].name,
+                   files[i].words, want_words);
+            fail = 1;
+            continue;
+        }
+        bytes += files[i].words * sizeof(int);
+        for (j = 0; j < files[i].words; j += VERIFY_BLOCK) {
+            jobs[num_jobs].file = i;
+            jobs[num_jobs].begin = j;
+            jobs[num_jobs].end = j + VERIFY_BLOCK < files[i].words ? j + VERIFY_BLOCK
+                                                                    : files[i].words;
+            num_jobs++;
+        }
+    }
+
+    gettimeofday(&s, NULL);
+    for (i = 0; i < VERIFY_THREADS; i++) pthread_create(&th[i], NULL, verify_worker, NULL);
+    for (i = 0; i < VERIFY_THREADS; i++) pthread_join(th[i], NULL);
+    gettimeofday(&e, NULL);
+
+    for (i = 0; i < num_files; i++) {
+        if (files[i].first_bad < 0) continue;
+        fail = 1;
+        if (files[i].want < 0)
+            printf("[VERIFY]        %s word %ld: chunk 시작값 %d 은 이 disk 의 chunk 가 아님\n",
+                   files[i].name, files[i].first_bad, files[i].got);
+        else
+            printf("[VERIFY]        %s word %ld: %d (기대 %d)\n", files[i].name,
+                   files[i].first_bad, files[i].got, files[i].want);
+    }
+#ifdef INCREMENTAL
+    (void)raid_files;
+#else
+    /* 압축 disk 가 없고 4 개가 다 있을 때만 chunk 가 빠짐없이 passes 번씩인지 본다 */
+    if (raid_files == 4) {
+        long missing = 0, dup = 0;
+
+        for (i = 0; i < TOTAL_CHUNKS; i++) {
+            if (seen[i] < passes) missing++;
+            if (seen[i] > passes) dup++;
+        }
+        if (missing || dup) {
+            printf("[VERIFY]        RAID chunk %ld 개 누락, %ld 개 중복 (chunk 당 %d 번 기대)\n",
+                   missing, dup, passes);
+            fail = 1;
+        }
+    }
+#endif
+
+    printf("[VERIFY]        %s: %d files, %ld bytes, %.6f sec, %.2f GB/s (%d threads, %s, %s) -> %s\n",
+           dir, num_files, bytes, GET_DURATION(s, e),
+           GET_DURATION(s, e) > 0 ? bytes / GET_DURATION(s, e) / 1e9 : 0.0,
+           VERIFY_THREADS, VERIFY_ISA, dst_layout.name, fail ? "FAIL" : "OK");
+
+    for (i = 0; i < num_files; i++)
+        if (files[i].p) munmap((void *)files[i].p, files[i].words * sizeof(int));
+    free(jobs);
+    return fail;
+}
+
+int main(int argc, char **argv) {
+    const char *dir = argc > 1 ? argv[1] : ".";
+    char sub[256];
+    int j, fail = 0;
+
+#ifdef COLLECTIVE
+    printf("[VERIFY]        %s: collective 출력은 지원하지 않음 (payload 가 index 가 아님, "
+           "project_final 의 coll_verify 결과 참고)\n", dir);
+    return 2;
+#endif
+    if (NUM_TENANTS == 1) {
+        snprintf(sub, sizeof(sub), "%s/job_0", dir);
+        if (access(sub, F_OK) == 0) {
+            snprintf(sub, sizeof(sub), "%s/ord_sm_0.bin", dir);
+            if (access(sub, F_OK) != 0) {
+                printf("[VERIFY]        %s: job_%%d/ 출력은 지원하지 않음 (-DNUM_TENANTS=J 로 빌드)\n",
+                       dir);
+                return 2;
+            }
+        }
+        passes = 1;
+        return verify_dir(dir);
+    }
+    for (j = 0; j < NUM_TENANTS; j++) {
+        snprintf(sub, sizeof(sub), "%s/job_%d", dir, j);
+        passes = TENANT_PASSES(j);
+        fail |= verify_dir(sub);
+    }
+    return fail;
+}